@@ -69,6 +69,7 @@ tresult PLUGIN_API LivecutController::initialize (FUnknown* context)
 	    Vst::ParameterInfo::kIsReadOnly;
 
 	editorDelegate = std::make_unique<EditorDelegate> (parameters);
+	editorDelegate->loadCutPattern = [this] (const auto& text) { sendCutPattern (text); };
 
 	auto freqToPlainFunc = [sampleRate = &sampleRate] (const Parameter& param, Vst::ParamValue norm)
 	{
@@ -137,6 +138,13 @@ tresult PLUGIN_API LivecutController::setComponentState (IBStream* state)
 		if (auto parameter = parameters.getParameterByIndex (index))
 			parameter->setNormalized (parameterDescriptions[index].defaultNormalized);
 	}
+	// the processor turns the pattern off when the state has none
+	uint32 patternSize = {};
+	if (!streamer.readInt32u (patternSize) || patternSize == 0)
+	{
+		if (auto parameter = parameters.getParameterByIndex (paramID (ParameterID::Pattern)))
+			parameter->setNormalized (0.);
+	}
 
 	return kResultOk;
 }
@@ -195,6 +203,21 @@ void LivecutController::onSampleRateChange (double sr)
 	sampleRate = sr;
 }
 
+//------------------------------------------------------------------------
+void LivecutController::sendCutPattern (const std::string& text)
+{
+	// the processor compiles the pattern and keeps its text in the state
+	if (auto msg = owned (allocateMessage ()))
+	{
+		msg->setMessageID ("CutPattern");
+		if (auto attr = msg->getAttributes ())
+		{
+			attr->setBinary ("Text", text.data (), static_cast<uint32> (text.size ()));
+			sendMessage (msg);
+		}
+	}
+}
+
 //------------------------------------------------------------------------
 tresult PLUGIN_API LivecutController::notify (Vst::IMessage* message)
 {
@@ -22,6 +22,7 @@
 
 #include "public.sdk/source/vst/vsteditcontroller.h"
 #include <memory>
+#include <string>
 
 namespace Livecut {
 
@@ -64,6 +65,7 @@ public:
 //------------------------------------------------------------------------
 protected:
 	void onSampleRateChange (double sampleRate);
+	void sendCutPattern (const std::string& text);
 
 	struct EditorDelegate;
 	std::unique_ptr<EditorDelegate> editorDelegate;
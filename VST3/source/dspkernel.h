@@ -28,11 +28,15 @@
 
 #include <algorithm>
 #include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
 
 //------------------------------------------------------------------------
 namespace Livecut {
 
 //------------------------------------------------------------------------
+template <typename SampleType>
 struct Kernel : BBCutListener
 {
 	Kernel () : bbcutter (player)
@@ -40,19 +44,38 @@ struct Kernel : BBCutListener
 		bbcutter.RegisterListener (&crusher);
 		bbcutter.RegisterListener (&comb);
 		bbcutter.RegisterListener (this);
+		crusher.SetRandom (&random);
+		comb.SetRandom (&random);
 		bbcutter.SetSubdiv (subDiv);
 	}
 
 	void setCutProc (int32_t index) { bbcutter.SetCutProc (index); }
-	void setSubDiv (int32_t value) { bbcutter.SetSubdiv (value); }
-	void setSeed (int32_t value) { Math::randomseed (value); }
+	void setUsePattern (bool state) { bbcutter.SetUsePattern (state); }
+	// may be called from any thread, the planner takes the pattern over at its next plan
+	void setCutPattern (std::unique_ptr<CutPattern> pattern)
+	{
+		bbcutter.SetCutPattern (std::move (pattern));
+	}
+	void setSubDiv (int32_t value)
+	{
+		subDiv = value;
+		bbcutter.SetSubdiv (value);
+	}
+	void setSeed (int32_t value)
+	{
+		random.Seed (value);
+		bbcutter.SetSeed (value);
+	}
 	void setFade (double ms) { bbcutter.SetFade (ms); }
+	void setEnvShape (int32_t shape) { player.SetEnvelopeShape (shape); }
 	void setMinAmp (double norm) { bbcutter.SetMinAmp (norm); }
 	void setMaxAmp (double norm) { bbcutter.SetMaxAmp (norm); }
 	void setMinPan (double value) { bbcutter.SetMinPan (value); }
 	void setMaxPan (double value) { bbcutter.SetMaxPan (value); }
 	void setMinPitch (double value) { bbcutter.SetMinDetune (value); }
 	void setMaxPitch (double value) { bbcutter.SetMaxDetune (value); }
+	void setPitchQuality (int32_t quality) { player.SetResamplerQuality (quality); }
+	void setCrossfade (bool state) { player.SetCrossfade (state); }
 	void setDuty (double value) { bbcutter.SetDutyCycle (value); }
 	void setFillDuty (double value) { bbcutter.SetFillDutyCycle (value); }
 	void setMaxPhrase (int32_t value) { bbcutter.SetMaxPhraseLength (value); }
@@ -81,18 +104,46 @@ struct Kernel : BBCutListener
 	}
 	void setComb (bool state) { comb.SetOn (state); }
 	void setCombType (bool type) { comb.SetType (type); }
-	void setCombFeedback (double feedback) { comb.SetFeedBack (feedback); }
+	// read every sample, the comb glides to it to avoid zipper noise
+	void setCombFeedback (double feedback)
+	{
+		comb.SetFeedBack (static_cast<float> (feedback), smoothing);
+	}
 	void setCombMinDelay (double ms) { comb.SetMinDelay (ms); }
 	void setCombMaxDelay (double ms) { comb.SetMaxDelay (ms); }
 
+	// not real-time safe. partners holds the mirrored channel of each channel for
+	// panning or its own index, left channels before their right partner
+	void setChannelLayout (const std::vector<int32_t>& partners)
+	{
+		std::vector<long> pairs (partners.begin (), partners.end ());
+		player.SetChannelPairs (pairs);
+		crusher.SetChannels (pairs.size ());
+		comb.SetChannels (pairs.size ());
+	}
+	uint32_t getNumChannels () const { return static_cast<uint32_t> (player.NumChannels ()); }
+
+	// not real-time safe, sizes the cut arena for the worst case at this rate.
+	// must be called before the first process call
 	void setSampleRate (double rate)
 	{
 		sampleRate = rate;
 		crusher.SetSampleRate (rate);
 		comb.SetSampleRate (rate);
+		bbcutter.Prepare (rate, MinTempo, MaxBeatsPerBar, SubDivValues.back ());
+		// until the next process call changes are taken over without a glide
+		smoothing = false;
 	}
 
-	using StereoBuffer = std::array<float*, 2>;
+	// not real-time safe. in the background the cuts are planned ahead on a
+	// worker thread, otherwise on demand in process
+	void setBackgroundPlanning (bool state) { bbcutter.SetBackgroundPlanning (state); }
+	// not real-time safe. memory for phrases planned before and replayed when they come up
+	// again, as in a looped region. off by default
+	void setPlanCacheBudget (size_t bytes) { bbcutter.SetPlanCacheBudget (bytes); }
+
+	// planar, one buffer per channel
+	using ChannelBuffers = SampleType* const*;
 	struct TimeInfo
 	{
 		double tempo {120};
@@ -103,56 +154,86 @@ struct Kernel : BBCutListener
 		bool transportChanged {false};
 	};
 
-	std::pair<float, float> process (StereoBuffer inputs, StereoBuffer outputs, uint32_t numSamples,
-	                                 const TimeInfo& timeInfo) noexcept
+	// samples the output may still sound after the input fell silent
+	uint32_t getTailSamples () const noexcept
+	{
+		int64_t samples = player.TailSamples () + crusher.TailSamples () +
+		                  comb.TailSamples (SilenceThreshold);
+		return static_cast<uint32_t> (std::min<int64_t> (samples, UINT32_MAX));
+	}
+
+	// processes numSamples from offset on, timeInfo as at offset.
+	// returns the peak of all output channels
+	float process (ChannelBuffers inputs, ChannelBuffers outputs, uint32_t offset,
+	               uint32_t numSamples, const TimeInfo& timeInfo,
+	               bool inputSilent = false) noexcept
 	{
 		phraseCount = blockCount = unitCount = cutCount = 0;
 
-		auto numSamplesD = static_cast<double> (numSamples);
-		auto subDivNumerator = static_cast<double> (subDiv) / timeInfo.numerator;
-		auto ppqBlockDuration = (numSamplesD / sampleRate) * (timeInfo.tempo / 60.0);
-		auto divPerSample =
-		    subDivNumerator * ppqBlockDuration * (timeInfo.denominator / 4.0) / numSamplesD;
-		auto position = subDivNumerator * timeInfo.ppqPos * (timeInfo.denominator / 4.0);
-		auto ref = 0.0;
-		auto oldPositionInMeasure =
-		    static_cast<int32_t> (std::floor (std::fmod (position - ref, subDiv)));
-		auto oldMeasure = static_cast<int32_t> (std::floor ((position - ref) / subDiv));
+		// once the input has been silent for longer than the cuts reach back the player only
+		// plays silence, and once that outlasted the effect tails nothing is left to render.
+		// the cutter and the player still follow the host position, so the cuts go on
+		// where they would have been when the input returns
+		auto playerSilent = inputSilent && silentSamples >= liveSamples ();
+		auto decayed = playerSilent && quietSamples >= effectTailSamples ();
+		silentSamples = inputSilent ? silentSamples + numSamples : 0;
+		quietSamples = playerSilent ? quietSamples + numSamples : 0;
+
+		// positions are in units, subDiv of them to the bar
+		auto unitsPerQuarter =
+		    static_cast<double> (subDiv) / timeInfo.numerator * (timeInfo.denominator / 4.0);
+		auto unitsPerSample = unitsPerQuarter * (timeInfo.tempo / 60.0) / sampleRate;
+		auto position = unitsPerQuarter * timeInfo.ppqPos;
+		auto unit = static_cast<int64_t> (std::floor (position));
 
 		bbcutter.SetTimeInfos (timeInfo.tempo, timeInfo.numerator, timeInfo.denominator,
 		                       sampleRate);
 
-		if (timeInfo.transportChanged && timeInfo.playing)
-			bbcutter.SetPosition (oldMeasure, oldPositionInMeasure);
+		// a jump of the host position, as when looping or scrubbing, seeks the cutter
+		// instead of carrying the phrase on from where it was
+		auto jumped = timeInfo.transportChanged || !wasPlaying ||
+		              std::abs (position - nextPosition) > MaxPositionDrift;
+		if (jumped && timeInfo.playing)
+		{
+			bbcutter.Seek (measureOf (unit), unit - measureOf (unit) * subDiv,
+			               position - std::floor (position));
+			currentUnit = unit;
+		}
+		wasPlaying = timeInfo.playing;
 
-		std::pair<float, float> peak = {0.f, 0.f};
+		float peak = 0.f;
 
-		for (int i = 0; i < numSamples; i++)
+		// the cutter is told of each unit at its first sample, including one starting on
+		// the first sample of this call, and renders whole units in between
+		auto end = offset + numSamples;
+		auto start = offset;
+		while (start < end)
 		{
-			int32_t positionInMeasure = int32_t (std::floor (std::fmod (position - ref, subDiv)));
-			int32_t measure = int32_t (std::floor ((position - ref) / subDiv));
-
-			if (positionInMeasure != oldPositionInMeasure)
+			if (unit != currentUnit)
 			{
-				bbcutter.SetPosition (measure, positionInMeasure);
-				oldPositionInMeasure = positionInMeasure;
+				bbcutter.SetPosition (measureOf (unit), unit - measureOf (unit) * subDiv);
+				currentUnit = unit;
 			}
-
-			float l = 0.f;
-			float r = 0.f;
-			player.tick (l, r, inputs[0][i], inputs[1][i]);
-			crusher.tick (l, r, l, r);
-			comb.tick (l, r, l, r);
-			outputs[0][i] = l;
-			outputs[1][i] = r;
-			auto absL = std::abs (l);
-			auto absR = std::abs (r);
-			if (absL > peak.first)
-				peak.first = absL;
-			if (absR > peak.second)
-				peak.second = absR;
-			oldMeasure = measure;
-			position += divPerSample;
+			auto next = end;
+			if (unitsPerSample > 0.)
+			{
+				auto boundary = offset + samplesUntil (static_cast<double> (unit + 1), position,
+				                                       unitsPerSample);
+				next = static_cast<uint32_t> (std::min<double> (boundary, end));
+			}
+			if (decayed)
+				skipSpan (inputs, start, next - start);
+			else
+				renderSpan (inputs, outputs, start, next - start, peak);
+			start = next;
+			unit = static_cast<int64_t> (std::floor (position + (start - offset) * unitsPerSample));
+		}
+		nextPosition = position + numSamples * unitsPerSample;
+		smoothing = true;
+		if (decayed)
+		{
+			for (auto c = 0; c < player.NumChannels (); ++c)
+				std::fill_n (outputs[c] + offset, numSamples, SampleType (0));
 		}
 		return peak;
 	}
@@ -163,18 +244,100 @@ struct Kernel : BBCutListener
 	uint32_t getCutCount () const { return cutCount; }
 
 private:
+	// samples of past input the player output still depends on
+	int64_t liveSamples () const noexcept
+	{
+		return player.LiveHistory () + bbcutter.LookbackSamples ();
+	}
+
+	// samples the effects sound on after the player fell silent
+	int64_t effectTailSamples () const noexcept
+	{
+		return crusher.TailSamples () + comb.TailSamples (SilenceThreshold);
+	}
+
+	int64_t measureOf (int64_t unit) const noexcept
+	{
+		return unit >= 0 ? unit / subDiv : (unit + 1) / subDiv - 1;
+	}
+
+	// the index of the first sample at or past boundary, at least one
+	static double samplesUntil (double boundary, double position, double unitsPerSample) noexcept
+	{
+		auto samples = std::max (std::ceil ((boundary - position) / unitsPerSample), 1.);
+		// the division may round across the boundary, the sample positions decide
+		if (samples > 1. && position + (samples - 1.) * unitsPerSample >= boundary)
+			samples -= 1.;
+		else if (position + samples * unitsPerSample < boundary)
+			samples += 1.;
+		return samples;
+	}
+
+	// as renderSpan while the output has decayed, the cuts and the glides go on unheard
+	void skipSpan (ChannelBuffers inputs, uint32_t offset, uint32_t numSamples) noexcept
+	{
+		while (numSamples > 0)
+		{
+			auto n = player.Skip (inputs, offset, numSamples);
+			crusher.Skip (n);
+			comb.Skip (n);
+			offset += n;
+			numSamples -= static_cast<uint32_t> (n);
+		}
+	}
+
+	void renderSpan (ChannelBuffers inputs, ChannelBuffers outputs, uint32_t offset,
+	                 uint32_t numSamples, float& peak) noexcept
+	{
+		while (numSamples > 0)
+		{
+			auto n = player.process (inputs, outputs, offset, numSamples);
+			crusher.process (outputs, offset, n);
+			comb.process (outputs, offset, n);
+			for (auto c = 0; c < player.NumChannels (); ++c)
+			{
+				auto out = outputs[c] + offset;
+				for (auto i = 0; i < n; ++i)
+				{
+					auto value = static_cast<float> (std::abs (out[i]));
+					if (value > peak)
+						peak = value;
+				}
+			}
+			offset += n;
+			numSamples -= static_cast<uint32_t> (n);
+		}
+	}
+
 	void OnPhrase (long bar, long sd) { ++phraseCount; }
 	void OnBlock (long bar, long sd) { ++blockCount; }
 	void OnUnit (long bar, long sd) { ++unitCount; }
 	void OnCut (long cut, long numcuts) { ++cutCount; }
 
-	LivePlayer player;
-	BitCrusher crusher;
-	Comb comb;
+	LivePlayer<SampleType> player;
+	BitCrusher<SampleType> crusher;
+	Comb<SampleType> comb;
 	BBCutter bbcutter;
+	// per instance, so instances neither share nor reseed each other's sequence.
+	// only the effects draw from it, the cut planner keys its own by position
+	Random random;
+
+	// slower tempi or longer bars get their cuts truncated
+	static constexpr double MinTempo {30.};
+	static constexpr double MaxBeatsPerBar {4.};
+	// in units, host positions off by less are not taken as a jump
+	static constexpr double MaxPositionDrift {0.25};
+	// tails are taken as decayed below this, about -100 dB
+	static constexpr float SilenceThreshold {1e-5f};
 
 	double sampleRate {44100.};
 	uint32_t subDiv {6};
+	double nextPosition {0.};
+	int64_t currentUnit {0};
+	bool wasPlaying {false};
+	bool smoothing {false};
+	int64_t silentSamples {0};
+	int64_t quietSamples {0};
 
 	uint32_t phraseCount {0};
 	uint32_t blockCount {0};
@@ -182,5 +345,122 @@ private:
 	uint32_t cutCount {0};
 };
 
+//------------------------------------------------------------------------
+template <typename SampleType>
+using KernelParameterSetter = void (*) (Kernel<SampleType>& kernel, double value);
+
+//------------------------------------------------------------------------
+// the kernel setter of each parameter, null for the ones the kernel does not handle
+template <typename SampleType>
+inline constexpr auto kernelParameterSetters = [] () {
+	using K = Kernel<SampleType>;
+	std::array<KernelParameterSetter<SampleType>, paramID (ParameterID::ParameterCount)> setters {};
+	auto set = [&] (ParameterID id, KernelParameterSetter<SampleType> setter) {
+		setters[paramID (id)] = setter;
+	};
+	set (ParameterID::CutProc, [] (K& k, double v) { k.setCutProc (v); });
+	set (ParameterID::SubDiv, [] (K& k, double v) { k.setSubDiv (v); });
+	set (ParameterID::Seed, [] (K& k, double v) { k.setSeed (v); });
+	set (ParameterID::Fade, [] (K& k, double v) { k.setFade (v); });
+	set (ParameterID::MinAmp, [] (K& k, double v) { k.setMinAmp (v); });
+	set (ParameterID::MaxAmp, [] (K& k, double v) { k.setMaxAmp (v); });
+	set (ParameterID::MinPan, [] (K& k, double v) { k.setMinPan (v); });
+	set (ParameterID::MaxPan, [] (K& k, double v) { k.setMaxPan (v); });
+	set (ParameterID::MinPitch, [] (K& k, double v) { k.setMinPitch (v); });
+	set (ParameterID::MaxPitch, [] (K& k, double v) { k.setMaxPitch (v); });
+	set (ParameterID::Duty, [] (K& k, double v) { k.setDuty (v); });
+	set (ParameterID::FillDuty, [] (K& k, double v) { k.setFillDuty (v); });
+	set (ParameterID::MaxPhrase, [] (K& k, double v) { k.setMaxPhrase (v); });
+	set (ParameterID::MinPhrase, [] (K& k, double v) { k.setMinPhrase (v); });
+	set (ParameterID::CutProc11MaxRepeat, [] (K& k, double v) { k.setMaxRepeat (v); });
+	set (ParameterID::CutProc11MinRepeat, [] (K& k, double v) { k.setMinRepeat (v); });
+	set (ParameterID::CutProc11Stutter, [] (K& k, double v) { k.setStutter (v); });
+	set (ParameterID::CutProc11Area, [] (K& k, double v) { k.setArea (v); });
+	set (ParameterID::WarpCutStraight, [] (K& k, double v) { k.setStraight (v); });
+	set (ParameterID::WarpCutRegular, [] (K& k, double v) { k.setRegular (v); });
+	set (ParameterID::WarpCutRitard, [] (K& k, double v) { k.setRitard (v); });
+	set (ParameterID::WarpCutSpeed, [] (K& k, double v) { k.setSpeed (v); });
+	set (ParameterID::SQPusherActivity, [] (K& k, double v) { k.setActivity (v); });
+	set (ParameterID::Crusher, [] (K& k, double v) { k.setBitcrusher (v); });
+	set (ParameterID::CrusherMinBits, [] (K& k, double v) { k.setMinBits (v); });
+	set (ParameterID::CrusherMaxBits, [] (K& k, double v) { k.setMaxBits (v); });
+	set (ParameterID::CrusherMinFreq, [] (K& k, double v) { k.setMinFreq (v); });
+	set (ParameterID::CrusherMaxFreq, [] (K& k, double v) { k.setMaxFreq (v); });
+	set (ParameterID::Comb, [] (K& k, double v) { k.setComb (v); });
+	set (ParameterID::CombType, [] (K& k, double v) { k.setCombType (v); });
+	set (ParameterID::CombFeedback, [] (K& k, double v) { k.setCombFeedback (v); });
+	set (ParameterID::CombMinDelay, [] (K& k, double v) { k.setCombMinDelay (v); });
+	set (ParameterID::CombMaxDelay, [] (K& k, double v) { k.setCombMaxDelay (v); });
+	set (ParameterID::EnvShape, [] (K& k, double v) { k.setEnvShape (v); });
+	set (ParameterID::PitchQuality, [] (K& k, double v) { k.setPitchQuality (v); });
+	set (ParameterID::Crossfade, [] (K& k, double v) { k.setCrossfade (v); });
+	set (ParameterID::Pattern, [] (K& k, double v) { k.setUsePattern (v); });
+	return setters;
+}();
+
+//------------------------------------------------------------------------
+// value is native, as ParamDesc::toNative gives it
+template <typename SampleType>
+inline void setKernelParameter (Kernel<SampleType>& kernel, ParamID pid, double value) noexcept
+{
+	if (auto setter = kernelParameterSetters<SampleType>[pid])
+		setter (kernel, value);
+}
+
+//------------------------------------------------------------------------
+// the normalized values of all parameters and the mask of the ones changed since the last
+// flush, so a parameter reaches the kernel once however often it changed in between
+class KernelParameters
+{
+public:
+	static constexpr ParamID Count = paramID (ParameterID::ParameterCount);
+	static_assert (Count <= 64, "one bit per parameter");
+	static constexpr uint64_t AllParameters = (static_cast<uint64_t> (1) << Count) - 1;
+
+	KernelParameters () noexcept
+	{
+		for (ParamID pid = 0; pid < Count; ++pid)
+			values[pid] = parameterDescriptions[pid].defaultNormalized;
+	}
+
+	// written directly, a value is not marked as changed
+	double& operator[] (ParamID pid) noexcept { return values[pid]; }
+	double operator[] (ParamID pid) const noexcept { return values[pid]; }
+	constexpr size_t size () const noexcept { return Count; }
+
+	// unknown ids and unchanged values are ignored
+	void change (ParamID pid, double value) noexcept
+	{
+		if (pid >= Count || values[pid] == value)
+			return;
+		values[pid] = value;
+		dirty |= static_cast<uint64_t> (1) << pid;
+	}
+	// the next flush hands over every parameter, as to a kernel that missed the changes
+	void changeAll () noexcept { dirty = AllParameters; }
+
+	// calls apply (pid, native value) for each changed parameter and clears the mask
+	template <typename Apply>
+	void flush (Apply&& apply) noexcept
+	{
+		auto bits = dirty;
+		dirty = 0;
+		for (ParamID pid = 0; bits != 0; ++pid, bits >>= 1)
+		{
+			if (bits & 1)
+				apply (pid, parameterDescriptions[pid].toNative (values[pid]));
+		}
+	}
+	template <typename SampleType>
+	void flush (Kernel<SampleType>& kernel) noexcept
+	{
+		flush ([&] (ParamID pid, double value) { setKernelParameter (kernel, pid, value); });
+	}
+
+private:
+	std::array<double, Count> values;
+	uint64_t dirty {0};
+};
+
 //------------------------------------------------------------------------
 } // Livecut
@@ -25,9 +25,12 @@
 #ifdef LIVECUT_VSTGUI_SUPPORT
 #include "vstgui4/vstgui/lib/animation/animations.h"
 #include "vstgui4/vstgui/lib/animation/timingfunctions.h"
+#include "vstgui4/vstgui/lib/cfileselector.h"
 #include "vstgui4/vstgui/lib/controls/ccontrol.h"
 #include "vstgui4/vstgui/lib/iviewlistener.h"
 #include "vstgui4/vstgui/uidescription/uiattributes.h"
+#include <fstream>
+#include <sstream>
 #endif
 
 //------------------------------------------------------------------------
@@ -167,6 +170,10 @@ auto LivecutController::EditorDelegate::verifyView (CView* view, const UIAttribu
 					item->setChecked (zf == editorZoom);
 					menu->addEntry (item);
 				}
+				menu->addSeparator ();
+				auto loadItem = new VSTGUI::CCommandMenuItem ("Load Cut Pattern...");
+				loadItem->setActions ([this, editor] (auto) { selectCutPattern (editor); });
+				menu->addEntry (loadItem);
 			}
 		}
 		else if (*customViewName == "CutVisBox")
@@ -206,6 +213,29 @@ auto LivecutController::EditorDelegate::verifyView (CView* view, const UIAttribu
 	return view;
 }
 
+//------------------------------------------------------------------------
+void LivecutController::EditorDelegate::selectCutPattern (VST3Editor* editor)
+{
+	using namespace VSTGUI;
+
+	auto selector = owned (CNewFileSelector::create (editor->getFrame (),
+	                                                 CNewFileSelector::kSelectFile));
+	if (!selector)
+		return;
+	selector->setTitle ("Load Cut Pattern");
+	selector->addFileExtension (CFileExtension ("Cut Pattern", "txt"));
+	selector->run ([this] (CNewFileSelector* s) {
+		if (s->getNumSelectedFiles () == 0 || !loadCutPattern)
+			return;
+		std::ifstream file (s->getSelectedFile (0), std::ios::binary);
+		if (!file)
+			return;
+		std::stringstream text;
+		text << file.rdbuf ();
+		loadCutPattern (text.str ());
+	});
+}
+
 //------------------------------------------------------------------------
 void LivecutController::EditorDelegate::viewWillDelete (CView* view)
 {
@@ -21,6 +21,8 @@
 #pragma once
 
 #include "controller.h"
+#include <functional>
+#include <string>
 
 #ifdef LIVECUT_VSTGUI_SUPPORT
 #include "vstgui4/vstgui/plugin-bindings/vst3editor.h"
@@ -63,6 +65,7 @@ struct LivecutController::EditorDelegate
 	void updateBoxIterator ();
 	
 	void onCutProcChanged (const Parameter& param, double newValue);
+	void selectCutPattern (VST3Editor* editor);
 
 	using ControlVector = std::vector<VSTGUI::CView*>;
 	ControlVector cutVisualBoxes;
@@ -82,6 +85,8 @@ struct LivecutController::EditorDelegate
 #endif
 
 	double editorZoom {1.};
+	// called with the text of the cut pattern file the user selected
+	std::function<void (const std::string& text)> loadCutPattern;
 };
 
 //------------------------------------------------------------------------
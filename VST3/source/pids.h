@@ -71,6 +71,10 @@ enum class ParameterID
 	Bypass,
 	CutCount,
 	BlockCount,
+	EnvShape,
+	PitchQuality,
+	Crossfade,
+	Pattern,
 	ParameterCount
 };
 
@@ -90,6 +94,12 @@ static const constexpr std::array<const char16_t*, 3> CutProcStrings = {u"CutPro
 
 static const constexpr std::array<const char16_t*, 2> CombTypeStrings = {u"FeedBack", u"FeedFwd"};
 
+static const constexpr std::array<const char16_t*, 4> EnvShapeStrings = {u"Exp", u"Linear",
+                                                                         u"Cosine", u"EqualPower"};
+
+static const constexpr std::array<const char16_t*, 3> PitchQualityStrings = {u"Draft", u"Normal",
+                                                                             u"High"};
+
 //------------------------------------------------------------------------
 static constexpr std::array<ParamDesc, paramID (ParameterID::ParameterCount)>
     parameterDescriptions = {{
@@ -177,6 +187,18 @@ static constexpr std::array<ParamDesc, paramID (ParameterID::ParameterCount)>
         {u"Bypass", 0., [] (auto v) { return v > 0.5 ? 1. : 0.; }, {StepCount {1}}},
         {u"CutCount", 0., [] (auto v) { return v; }, {Range {0., 1000.}}},
         {u"BlockCount", 0., [] (auto v) { return v; }, {Range {0., 1000.}}},
+        {u"Env Shape",
+         0.,
+         [] (auto v) { return normalizedToSteps<double> (3, 0, v); },
+         {StepCount {3}},
+         EnvShapeStrings.data ()},
+        {u"Pitch Quality",
+         0.5,
+         [] (auto v) { return normalizedToSteps<double> (2, 0, v); },
+         {StepCount {2}},
+         PitchQualityStrings.data ()},
+        {u"Crossfade", 0., [] (auto v) { return v > 0.5 ? 1. : 0.; }, {StepCount {1}}},
+        {u"Pattern", 0., [] (auto v) { return v > 0.5 ? 1. : 0.; }, {StepCount {1}}},
     }};
 
 //------------------------------------------------------------------------
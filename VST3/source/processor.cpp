@@ -26,11 +26,54 @@
 #include "pluginterfaces/vst/ivstparameterchanges.h"
 #include "pluginterfaces/vst/ivstprocesscontext.h"
 
+#include <algorithm>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 using namespace Steinberg;
 
 //------------------------------------------------------------------------
 namespace Livecut {
 
+//------------------------------------------------------------------------
+template struct Kernel<float>;
+template struct Kernel<double>;
+
+//------------------------------------------------------------------------
+// mirrored speakers share the stereo panning of a cut, the others only get its amp
+static std::vector<int32_t> channelPartners (Vst::SpeakerArrangement arrangement)
+{
+	using namespace Vst;
+	static constexpr std::pair<Speaker, Speaker> mirrored[] = {
+	    {kSpeakerL, kSpeakerR},     {kSpeakerLs, kSpeakerRs},   {kSpeakerLc, kSpeakerRc},
+	    {kSpeakerSl, kSpeakerSr},   {kSpeakerTfl, kSpeakerTfr}, {kSpeakerTrl, kSpeakerTrr},
+	    {kSpeakerTsl, kSpeakerTsr}, {kSpeakerLcs, kSpeakerRcs}};
+
+	auto numChannels = SpeakerArr::getChannelCount (arrangement);
+	std::vector<int32_t> partners (numChannels);
+	for (auto channel = 0; channel < numChannels; ++channel)
+	{
+		partners[channel] = channel;
+		auto speaker = SpeakerArr::getSpeaker (arrangement, channel);
+		for (const auto& pair : mirrored)
+		{
+			Speaker other = speaker == pair.first ? pair.second :
+			                speaker == pair.second ? pair.first : 0;
+			if (other == 0)
+				continue;
+			for (auto index = 0; index < numChannels; ++index)
+			{
+				if (SpeakerArr::getSpeaker (arrangement, index) == other)
+					partners[channel] = index;
+			}
+			break;
+		}
+	}
+	return partners;
+}
+
 //------------------------------------------------------------------------
 struct LivecutProcessor::ParameterUpdater
 {
@@ -103,8 +146,6 @@ LivecutProcessor::LivecutProcessor ()
 {
 	//--- set the wanted controller for our processor
 	setControllerClass (kLivecutControllerUID);
-	for (auto index = 0u; index < parameters.size(); ++index)
-		parameters[index] = parameterDescriptions[index].defaultNormalized;
 
 	processContextRequirements.needTempo ()
 	    .needProjectTimeMusic ()
@@ -113,6 +154,7 @@ LivecutProcessor::LivecutProcessor ()
 
 	cutCountUpdater = std::make_unique<ParameterUpdater> (paramID (ParameterID::CutCount));
 	blockCountUpdater = std::make_unique<ParameterUpdater> (paramID (ParameterID::BlockCount));
+	parameterEvents.reserve (MaxParameterEvents);
 }
 
 //------------------------------------------------------------------------
@@ -144,18 +186,24 @@ tresult PLUGIN_API LivecutProcessor::terminate ()
 tresult PLUGIN_API LivecutProcessor::setBusArrangements (SpeakerArrangement* inputs, int32 numIns,
                                                          SpeakerArrangement* outputs, int32 numOuts)
 {
-	// Livecut only supports Stereo
+	// Livecut cuts any channel layout, as long as input and output match
 	if (numIns != numOuts || numIns != 1)
 		return kResultFalse;
-	if (inputs[0] != outputs[0] || inputs[0] != Vst::SpeakerArr::kStereo)
+	if (inputs[0] != outputs[0] || Vst::SpeakerArr::getChannelCount (inputs[0]) < 1)
 		return kResultFalse;
-	return kResultTrue;
+	return AudioEffect::setBusArrangements (inputs, numIns, outputs, numOuts);
 }
 
 //------------------------------------------------------------------------
 tresult PLUGIN_API LivecutProcessor::setActive (TBool state)
 {
 	//--- called when the Plug-in is enable/disable (On/Off) -----
+	// cuts are planned ahead on a worker thread while running in real time,
+	// offline renders plan on demand so that they stay reproducible
+	auto background = state && processSetup.processMode != Vst::kOffline;
+	auto is64 = processSetup.symbolicSampleSize == Vst::kSample64;
+	kernel32.setBackgroundPlanning (background && !is64);
+	kernel64.setBackgroundPlanning (background && is64);
 	return AudioEffect::setActive (state);
 }
 
@@ -165,50 +213,92 @@ tresult PLUGIN_API LivecutProcessor::process (Vst::ProcessData& data)
 	stateTransfer.accessTransferObject_rt ([&] (auto state) {
 		for (auto index = 0u; index < paramID (ParameterID::ParameterCount); ++index)
 		{
-			updateKernelParameter (index, state[index]);
+			changeParameter (index, state[index]);
 		}
 	});
+	parameterEvents.clear ();
 	if (data.inputParameterChanges)
+		collectParameterEvents (*data.inputParameterChanges);
+
+	tresult result = kResultTrue;
+	if (data.numSamples > 0)
 	{
-		int32 numParamsChanged = data.inputParameterChanges->getParameterCount ();
-		for (int32 index = 0; index < numParamsChanged; index++)
-		{
-			if (auto* paramQueue = data.inputParameterChanges->getParameterData (index))
-			{
-				Vst::ParamValue value;
-				int32 sampleOffset;
-				int32 numPoints = paramQueue->getPointCount ();
-				if (paramQueue->getPoint (numPoints - 1, sampleOffset, value) == kResultTrue)
-					updateKernelParameter (paramQueue->getParameterId (), value);
-			}
-		}
+		if (data.symbolicSampleSize == Vst::kSample64)
+			result = processKernel (kernel64, data);
+		else
+			result = processKernel (kernel32, data);
 	}
+	// changes not consumed by the kernel, as on a parameter flush, still take effect
+	for (const auto& event : parameterEvents)
+		changeParameter (event.id, event.value);
+	parameterEvents.clear ();
+	flushParameters ();
+	return result;
+}
 
-	if (data.numSamples <= 0)
-		return kResultTrue;
+//------------------------------------------------------------------------
+void LivecutProcessor::collectParameterEvents (Vst::IParameterChanges& changes) noexcept
+{
+	int32 order = 0;
+	int32 numParamsChanged = changes.getParameterCount ();
+	for (int32 index = 0; index < numParamsChanged; index++)
+	{
+		auto* paramQueue = changes.getParameterData (index);
+		if (!paramQueue)
+			continue;
+		auto id = paramQueue->getParameterId ();
+		int32 numPoints = paramQueue->getPointCount ();
+		if (parameterEvents.size () + numPoints > MaxParameterEvents)
+		{
+			// out of room, the parameter takes its final value for the whole block. points
+			// queued for it before are dropped so that none of them overrides that value
+			int32 sampleOffset;
+			Vst::ParamValue value;
+			if (numPoints <= 0 ||
+			    paramQueue->getPoint (numPoints - 1, sampleOffset, value) != kResultTrue)
+				continue;
+			parameterEvents.erase (std::remove_if (parameterEvents.begin (), parameterEvents.end (),
+			                                       [id] (const auto& e) { return e.id == id; }),
+			                       parameterEvents.end ());
+			changeParameter (id, value);
+			continue;
+		}
+		for (int32 point = 0; point < numPoints; ++point)
+		{
+			ParameterEvent event {0, order++, id, 0.};
+			if (paramQueue->getPoint (point, event.sampleOffset, event.value) == kResultTrue)
+				parameterEvents.push_back (event);
+		}
+	}
+	// points of one queue arrive in order, the order field keeps them so for equal offsets
+	std::sort (parameterEvents.begin (), parameterEvents.end (),
+	           [] (const auto& a, const auto& b) {
+		           if (a.sampleOffset != b.sampleOffset)
+			           return a.sampleOffset < b.sampleOffset;
+		           return a.order < b.order;
+	           });
+}
 
-	Kernel::StereoBuffer inputs;
-	Kernel::StereoBuffer outputs;
+//------------------------------------------------------------------------
+template <typename SampleType>
+tresult LivecutProcessor::processKernel (Kernel<SampleType>& kernel,
+                                         Vst::ProcessData& data) noexcept
+{
+	auto channelBuffers = [] (Vst::AudioBusBuffers& bus) {
+		if constexpr (std::is_same_v<SampleType, double>)
+			return bus.channelBuffers64;
+		else
+			return bus.channelBuffers32;
+	};
 
 	auto& ins = data.inputs[0];
-	inputs[0] = ins.channelBuffers32[0];
-	inputs[1] = ins.channelBuffers32[1];
 	auto& outs = data.outputs[0];
-	outputs[0] = outs.channelBuffers32[0];
-	outputs[1] = outs.channelBuffers32[1];
-
-	if (doBypass)
-	{
-		for (auto index = 0; index < 2; ++index)
-		{
-			if (inputs[index] != outputs[index])
-				memcpy(outputs[index], inputs[index], data.numSamples * sizeof (float));
-		}
-		outs.silenceFlags = ins.silenceFlags;
-		return kResultTrue;
-	}
+	auto inputs = channelBuffers (ins);
+	auto outputs = channelBuffers (outs);
+	if (static_cast<uint32> (outs.numChannels) != kernel.getNumChannels ())
+		return kResultFalse;
 
-	Kernel::TimeInfo timeInfo {};
+	typename Kernel<SampleType>::TimeInfo timeInfo {};
 	if (auto processContext = data.processContext)
 	{
 		if (processContext->state & Vst::ProcessContext::kTempoValid)
@@ -224,15 +314,67 @@ tresult PLUGIN_API LivecutProcessor::process (Vst::ProcessData& data)
 		timeInfo.transportChanged = false; // TODO: need transport state observer
 	}
 
-	auto peak = kernel.process (inputs, outputs, data.numSamples, timeInfo);
+	// the kernel stops rendering once the tails of a silent input have decayed
+	auto channelMask = [] (int32 numChannels) -> uint64 {
+		return numChannels >= 64 ? ~0ull : (1ull << numChannels) - 1;
+	};
+	auto allChannels = channelMask (ins.numChannels);
+	auto inputSilent = (ins.silenceFlags & allChannels) == allChannels;
+
+	// the block is split at every parameter change, without automation it is processed
+	// in one go
+	auto ppqPerSample = timeInfo.tempo / (60.0 * processSetup.sampleRate);
+	auto event = parameterEvents.begin ();
+	auto peak = 0.f;
+	auto bypassed = false;
+	auto processed = false;
+	uint32 cutCount = 0;
+	uint32 blockCount = 0;
+	int32 start = 0;
+	while (start < data.numSamples)
+	{
+		for (; event != parameterEvents.end () && event->sampleOffset <= start; ++event)
+			changeParameter (event->id, event->value);
+		flushParameters (kernel);
+		auto end = data.numSamples;
+		if (event != parameterEvents.end ())
+			end = std::min (event->sampleOffset, data.numSamples);
+
+		if (doBypass)
+		{
+			for (auto index = 0; index < outs.numChannels; ++index)
+			{
+				if (inputs[index] != outputs[index])
+					memcpy (outputs[index] + start, inputs[index] + start,
+					        (end - start) * sizeof (SampleType));
+			}
+			bypassed = true;
+		}
+		else
+		{
+			auto spanTimeInfo = timeInfo;
+			spanTimeInfo.ppqPos += start * ppqPerSample;
+			peak = std::max (peak, kernel.process (inputs, outputs, start, end - start,
+			                                       spanTimeInfo, inputSilent));
+			cutCount += kernel.getCutCount ();
+			blockCount += kernel.getBlockCount ();
+			processed = true;
+		}
+		start = end;
+	}
+	parameterEvents.erase (parameterEvents.begin (), event);
 
-	// propagate possible silence to next plug-in
+	// propagate possible silence to next plug-in, the flags are set anew every block
 	constexpr auto silence = 0.f;
-	if (peak.first <= silence && peak.second <= silence)
-		outs.silenceFlags = 0x3;
+	if (!processed)
+		outs.silenceFlags = ins.silenceFlags;
+	else if (!bypassed && peak <= silence)
+		outs.silenceFlags = channelMask (outs.numChannels);
+	else
+		outs.silenceFlags = 0;
 
-	parameters[paramID(ParameterID::CutCount)] += kernel.getCutCount () / 1000.;
-	parameters[paramID(ParameterID::BlockCount)] += kernel.getBlockCount () / 1000.;
+	parameters[paramID(ParameterID::CutCount)] += cutCount / 1000.;
+	parameters[paramID(ParameterID::BlockCount)] += blockCount / 1000.;
 	cutCountUpdater->process (parameters[paramID (ParameterID::CutCount)], data,
 	                          [this] (auto, auto v, auto) {
 		                          parameters[paramID (ParameterID::CutCount)] = 0.;
@@ -249,7 +391,31 @@ tresult PLUGIN_API LivecutProcessor::process (Vst::ProcessData& data)
 //------------------------------------------------------------------------
 tresult PLUGIN_API LivecutProcessor::setupProcessing (Vst::ProcessSetup& newSetup)
 {
-	kernel.setSampleRate (newSetup.sampleRate);
+	auto result = AudioEffect::setupProcessing (newSetup);
+	if (result != kResultOk)
+		return result;
+	Vst::SpeakerArrangement arrangement;
+	if (getBusArrangement (Vst::kOutput, 0, arrangement) != kResultTrue)
+		arrangement = Vst::SpeakerArr::kStereo;
+	// offline renders have no deadline to keep, planning a looped phrase again costs
+	// nothing audible there
+	auto cacheBytes = newSetup.processMode == Vst::kOffline ? 0 : PlanCacheBytes;
+	auto prepare = [&] (auto& kernel, auto& other) {
+		kernel.setChannelLayout (channelPartners (arrangement));
+		kernel.setSampleRate (newSetup.sampleRate);
+		kernel.setPlanCacheBudget (cacheBytes);
+		other.setPlanCacheBudget (0);
+	};
+	// the kernel of the other sample size keeps its state but gets no updates,
+	// so hand it all parameters when it becomes the active one
+	if (newSetup.symbolicSampleSize == Vst::kSample64)
+		prepare (kernel64, kernel32);
+	else
+		prepare (kernel32, kernel64);
+	parameters.changeAll ();
+	flushParameters ();
+	if (!cutPatternText.empty ())
+		loadCutPattern (cutPatternText);
 	cutCountUpdater->init (newSetup.sampleRate, 30);
 	blockCountUpdater->init (newSetup.sampleRate, 30);
 	if (auto msg = owned (allocateMessage ()))
@@ -261,18 +427,26 @@ tresult PLUGIN_API LivecutProcessor::setupProcessing (Vst::ProcessSetup& newSetu
 			sendMessage (msg);
 		}
 	}
-	return AudioEffect::setupProcessing (newSetup);
+	return kResultOk;
 }
 
 //------------------------------------------------------------------------
 tresult PLUGIN_API LivecutProcessor::canProcessSampleSize (int32 symbolicSampleSize)
 {
-	if (symbolicSampleSize == Vst::kSample32)
+	if (symbolicSampleSize == Vst::kSample32 || symbolicSampleSize == Vst::kSample64)
 		return kResultTrue;
 
 	return kResultFalse;
 }
 
+//------------------------------------------------------------------------
+uint32 PLUGIN_API LivecutProcessor::getTailSamples ()
+{
+	if (processSetup.symbolicSampleSize == Vst::kSample64)
+		return kernel64.getTailSamples ();
+	return kernel32.getTailSamples ();
+}
+
 //------------------------------------------------------------------------
 tresult PLUGIN_API LivecutProcessor::setState (IBStream* state)
 {
@@ -300,6 +474,24 @@ tresult PLUGIN_API LivecutProcessor::setState (IBStream* state)
 			return kInternalError;
 	}
 
+	// states saved before cut patterns existed end here
+	uint32 patternSize = {};
+	std::string text;
+	if (streamer.readInt32u (patternSize) && patternSize > 0)
+	{
+		text.resize (patternSize);
+		if (streamer.readRaw (text.data (), patternSize) != static_cast<int32> (patternSize))
+			return kInternalError;
+	}
+	if (text.empty ())
+	{
+		// a state without a pattern does not keep the one loaded before
+		parameterState[paramID (ParameterID::Pattern)] = 0.;
+		clearCutPattern ();
+	}
+	else if (text != cutPatternText && !loadCutPattern (text))
+		return kResultFalse;
+
 	stateTransfer.transferObject_ui (std::make_unique<ParameterArray> (std::move (parameterState)));
 
 	return kResultOk;
@@ -319,192 +511,77 @@ tresult PLUGIN_API LivecutProcessor::getState (IBStream* state)
 	for (auto index = 0u; index < paramID (ParameterID::ParameterCount); ++index)
 		streamer.writeDouble (parameters[index]);
 
+	streamer.writeInt32u (static_cast<uint32> (cutPatternText.size ()));
+	streamer.writeRaw (cutPatternText.data (), static_cast<int32> (cutPatternText.size ()));
+
 	return kResultOk;
 }
 
 //------------------------------------------------------------------------
-void LivecutProcessor::updateKernelParameter (ParamID pid, ParamValue value) noexcept
+tresult PLUGIN_API LivecutProcessor::notify (Vst::IMessage* message)
 {
-	parameters[pid] = value;
-	value = parameterDescriptions[pid].toNative (value);
-	switch (static_cast<ParameterID> (pid))
-	{
-		case ParameterID::CutProc:
-		{
-			kernel.setCutProc (value);
-			break;
-		}
-		case ParameterID::SubDiv:
-		{
-			kernel.setSubDiv (value);
-			break;
-		}
-		case ParameterID::Seed:
-		{
-			kernel.setSeed (value);
-			break;
-		}
-		case ParameterID::Fade:
-		{
-			kernel.setFade (value);
-			break;
-		}
-		case ParameterID::MinAmp:
-		{
-			kernel.setMinAmp (value);
-			break;
-		}
-		case ParameterID::MaxAmp:
-		{
-			kernel.setMaxAmp (value);
-			break;
-		}
-		case ParameterID::MinPan:
-		{
-			kernel.setMinPan (value);
-			break;
-		}
-		case ParameterID::MaxPan:
-		{
-			kernel.setMaxPan (value);
-			break;
-		}
-		case ParameterID::MinPitch:
-		{
-			kernel.setMinPitch (value);
-			break;
-		}
-		case ParameterID::MaxPitch:
-		{
-			kernel.setMaxPitch (value);
-			break;
-		}
-		case ParameterID::Duty:
-		{
-			kernel.setDuty (value);
-			break;
-		}
-		case ParameterID::FillDuty:
-		{
-			kernel.setFillDuty (value);
-			break;
-		}
-		case ParameterID::MaxPhrase:
-		{
-			kernel.setMaxPhrase (value);
-			break;
-		}
-		case ParameterID::MinPhrase:
-		{
-			kernel.setMinPhrase (value);
-			break;
-		}
-		case ParameterID::CutProc11MaxRepeat:
-		{
-			kernel.setMaxRepeat (value);
-			break;
-		}
-		case ParameterID::CutProc11MinRepeat:
-		{
-			kernel.setMinRepeat (value);
-			break;
-		}
-		case ParameterID::CutProc11Stutter:
-		{
-			kernel.setStutter (value);
-			break;
-		}
-		case ParameterID::CutProc11Area:
-		{
-			kernel.setArea (value);
-			break;
-		}
-		case ParameterID::WarpCutStraight:
-		{
-			kernel.setStraight (value);
-			break;
-		}
-		case ParameterID::WarpCutRegular:
-		{
-			kernel.setRegular (value);
-			break;
-		}
-		case ParameterID::WarpCutRitard:
-		{
-			kernel.setRitard (value);
-			break;
-		}
-		case ParameterID::WarpCutSpeed:
-		{
-			kernel.setSpeed (value);
-			break;
-		}
-		case ParameterID::SQPusherActivity:
-		{
-			kernel.setActivity (value);
-			break;
-		}
-		case ParameterID::Crusher:
-		{
-			kernel.setBitcrusher (value);
-			break;
-		}
-		case ParameterID::CrusherMinBits:
-		{
-			kernel.setMinBits (value);
-			break;
-		}
-		case ParameterID::CrusherMaxBits:
-		{
-			kernel.setMaxBits (value);
-			break;
-		}
-		case ParameterID::CrusherMinFreq:
-		{
-			kernel.setMinFreq (value);
-			break;
-		}
-		case ParameterID::CrusherMaxFreq:
-		{
-			kernel.setMaxFreq (value);
-			break;
-		}
-		case ParameterID::Comb:
-		{
-			kernel.setComb (value);
-			break;
-		}
-		case ParameterID::CombType:
-		{
-			kernel.setCombType (value);
-			break;
-		}
-		case ParameterID::CombFeedback:
-		{
-			kernel.setCombFeedback (value);
-			break;
-		}
-		case ParameterID::CombMinDelay:
-		{
-			kernel.setCombMinDelay (value);
-			break;
-		}
-		case ParameterID::CombMaxDelay:
-		{
-			kernel.setCombMaxDelay (value);
-			break;
-		}
-		case ParameterID::Bypass:
-		{
+	// the controller sends the text of a cut pattern, it is compiled here on the UI thread
+	// and handed to the planner of the active kernel without blocking the audio thread
+	auto msgID = message ? message->getMessageID () : nullptr;
+	if (!msgID || std::string_view (msgID) != "CutPattern")
+		return AudioEffect::notify (message);
+	auto attrs = message->getAttributes ();
+	const void* data = nullptr;
+	uint32 size = 0;
+	if (!attrs || attrs->getBinary ("Text", data, size) != kResultTrue)
+		return kResultFalse;
+	return loadCutPattern ({static_cast<const char*> (data), size}) ? kResultTrue : kResultFalse;
+}
+
+//------------------------------------------------------------------------
+bool LivecutProcessor::loadCutPattern (const std::string& text)
+{
+	auto pattern = std::make_unique<CutPattern> ();
+	std::string error;
+	if (!CompileCutPattern (text, *pattern, error))
+		return false;
+	cutPatternText = text;
+	if (processSetup.symbolicSampleSize == Vst::kSample64)
+		kernel64.setCutPattern (std::move (pattern));
+	else
+		kernel32.setCutPattern (std::move (pattern));
+	return true;
+}
+
+//------------------------------------------------------------------------
+void LivecutProcessor::clearCutPattern ()
+{
+	// both kernels, the other one keeps its pattern when it becomes the active one
+	cutPatternText.clear ();
+	kernel32.setCutPattern (nullptr);
+	kernel64.setCutPattern (nullptr);
+}
+
+//------------------------------------------------------------------------
+void LivecutProcessor::changeParameter (ParamID pid, ParamValue value) noexcept
+{
+	parameters.change (pid, value);
+}
+
+//------------------------------------------------------------------------
+void LivecutProcessor::flushParameters () noexcept
+{
+	if (processSetup.symbolicSampleSize == Vst::kSample64)
+		flushParameters (kernel64);
+	else
+		flushParameters (kernel32);
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+void LivecutProcessor::flushParameters (Kernel<SampleType>& kernel) noexcept
+{
+	parameters.flush ([&] (ParamID pid, double value) {
+		if (pid == paramID (ParameterID::Bypass))
 			doBypass = value;
-			break;
-		}
-		case ParameterID::ParameterCount:
-		{
-			assert (false);
-			break;
-		}
-	}
+		else
+			setKernelParameter (kernel, pid, value);
+	});
 }
 
 //------------------------------------------------------------------------
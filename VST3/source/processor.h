@@ -26,6 +26,8 @@
 #include "public.sdk/source/vst/vstaudioeffect.h"
 
 #include <array>
+#include <string>
+#include <vector>
 
 namespace Livecut {
 
@@ -56,23 +58,57 @@ public:
 	tresult PLUGIN_API setBusArrangements (SpeakerArrangement* inputs, int32 numIns,
 	                                       SpeakerArrangement* outputs, int32 numOuts) override;
 	tresult PLUGIN_API canProcessSampleSize (int32 symbolicSampleSize) override;
+	Steinberg::uint32 PLUGIN_API getTailSamples () override;
 	tresult PLUGIN_API process (Steinberg::Vst::ProcessData& data) override;
 	tresult PLUGIN_API setState (Steinberg::IBStream* state) override;
 	tresult PLUGIN_API getState (Steinberg::IBStream* state) override;
 
+	// IConnectionPoint
+	tresult PLUGIN_API notify (Steinberg::Vst::IMessage* message) override;
+
 //------------------------------------------------------------------------
 protected:
 	using ParamValue = Steinberg::Vst::ParamValue;
 	using ParameterArray = std::array<ParamValue, paramID (ParameterID::ParameterCount)>;
 	using RTTransfer = Steinberg::Vst::RTTransferT<ParameterArray>;
 
-	void updateKernelParameter (ParamID pid, Steinberg::Vst::ParamValue value) noexcept;
+	// changes are collected in parameters and handed to the kernel by flushParameters,
+	// once per parameter however often it changed in between
+	void changeParameter (ParamID pid, Steinberg::Vst::ParamValue value) noexcept;
+	void flushParameters () noexcept;
+	template <typename SampleType>
+	void flushParameters (Kernel<SampleType>& kernel) noexcept;
+	template <typename SampleType>
+	tresult processKernel (Kernel<SampleType>& kernel, Steinberg::Vst::ProcessData& data) noexcept;
+	bool loadCutPattern (const std::string& text);
+	void clearCutPattern ();
+	void collectParameterEvents (Steinberg::Vst::IParameterChanges& changes) noexcept;
+
+	// a parameter change at a sample offset of the current block
+	struct ParameterEvent
+	{
+		int32 sampleOffset;
+		int32 order;
+		ParamID id;
+		Steinberg::Vst::ParamValue value;
+	};
+	// a parameter whose points do not fit in a block any more takes its final value for all of it
+	static constexpr size_t MaxParameterEvents = 4096;
+	// phrases the active kernel keeps for looped playback, about a thousand at typical
+	// cut counts
+	static constexpr size_t PlanCacheBytes = 4 * 1024 * 1024;
 
-	ParameterArray parameters;
-	Kernel kernel;
+	KernelParameters parameters;
+	// only the kernel matching the negotiated sample size is prepared and processed
+	Kernel<float> kernel32;
+	Kernel<double> kernel64;
 	bool doBypass {false};
+	// the source of the loaded cut pattern, kept for the state and for recompiling it
+	// when the other kernel becomes the active one
+	std::string cutPatternText;
 	
 	RTTransfer stateTransfer;
+	std::vector<ParameterEvent> parameterEvents;
 
 	struct ParameterUpdater;
 	std::unique_ptr<ParameterUpdater> cutCountUpdater;
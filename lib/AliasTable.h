@@ -0,0 +1,134 @@
+/*
+ This file is part of Livecut
+ Copyright 2026 by the Livecut contributors.
+ 
+ Livecut can be redistributed and/or modified under the terms of the
+ GNU General Public License, as published by the Free Software Foundation;
+ either version 2 of the License, or (at your option) any later version.
+ 
+ Livecut is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Livecut; if not, visit www.gnu.org/licenses or write to the
+ Free Software Foundation, Inc., 59 Temple Place, Suite 330, 
+ Boston, MA 02111-1307 USA
+ */
+
+#ifndef LIVECUT_ALIAS_TABLE_H
+#define LIVECUT_ALIAS_TABLE_H
+
+#include "Random.h"
+
+/**
+ @brief Vose's method over n weights, prob and alias receive the table.
+ scaled, small and large are scratch of n entries each. constexpr, so that
+ fixed weights are turned into a table at compile time
+ */
+constexpr void BuildAliasTable(const double *weights, long n, double *prob, long *alias,
+                               double *scaled, long *small, long *large)
+{
+  double sum = 0.0;
+  for(long i=0;i<n;i++)
+    sum += weights[i];
+  
+  // split into the entries below and above the mean, then pair them up
+  long numsmall = 0, numlarge = 0;
+  for(long i=0;i<n;i++)
+  {
+    scaled[i] = (sum>0.0)? weights[i]*double(n)/sum : 1.0;
+    if(scaled[i]<1.0)
+      small[numsmall++] = i;
+    else
+      large[numlarge++] = i;
+  }
+  while(numsmall>0 && numlarge>0)
+  {
+    const long s = small[--numsmall];
+    const long l = large[--numlarge];
+    prob[s] = scaled[s];
+    alias[s] = l;
+    scaled[l] = (scaled[l]+scaled[s])-1.0;
+    if(scaled[l]<1.0)
+      small[numsmall++] = l;
+    else
+      large[numlarge++] = l;
+  }
+  // leftovers are 1 up to rounding errors
+  while(numlarge>0)
+  {
+    const long l = large[--numlarge];
+    prob[l] = 1.0;
+    alias[l] = l;
+  }
+  while(numsmall>0)
+  {
+    const long s = small[--numsmall];
+    prob[s] = 1.0;
+    alias[s] = s;
+  }
+}
+
+// one uniform draw picks the column and decides between it and its alias
+template<class R>
+inline long AliasIndex(R &random, const double *prob, const long *alias, long n)
+{
+  const double x = random.Uniform()*double(n);
+  long i = long(x);
+  if(i>=n)
+    i = n-1;
+  return (x-double(i) < prob[i])? i : alias[i];
+}
+
+/**
+ @brief Vose alias table for drawing one of N weighted values in O(1).
+ the constructor is constexpr, fixed weights are turned into a table at
+ compile time, weights depending on parameters are built when they change.
+ drawing never allocates.
+ */
+template<long N>
+class AliasTable
+{
+public:
+  constexpr AliasTable() : prob{}, alias{}
+  {
+    for(long i=0;i<N;i++)
+    {
+      prob[i] = 1.0;
+      alias[i] = i;
+    }
+  }
+  
+  constexpr AliasTable(const double (&weights)[N]) : prob{}, alias{}
+  {
+    Build(weights);
+  }
+  
+  constexpr void Build(const double (&weights)[N])
+  {
+    double scaled[N] = {};
+    long small[N] = {};
+    long large[N] = {};
+    BuildAliasTable(weights,N,prob,alias,scaled,small,large);
+  }
+  
+  template<class R>
+  inline long Index(R &random) const
+  {
+    return AliasIndex(random,prob,alias,N);
+  }
+  
+  template<class T, class R>
+  inline T Choose(R &random, const T *values) const
+  {
+    return values[Index(random)];
+  }
+  
+private:
+  double prob[N];
+  long alias[N];
+};
+
+#endif
@@ -23,13 +23,14 @@
 CutInfo::CutInfo()
 : size(0)
 , length(0)
+, offset(0)
 , pan(0.f)
 , amp(1.f)
 , cents(0.f)
 {
 }
 
-CutProc::CutProc()
+CutParams::CutParams()
 : minamp(1.f)
 , maxamp(1.f)
 , minpan(0.5f)
@@ -38,47 +39,40 @@ CutProc::CutProc()
 , maxdetune(0.f)
 , dutycycle(1.f)
 , filldutycycle(1.f)
-, maxphraselength(4)
 , minphraselength(1)
+, maxphraselength(4)
+, maxcutlength(0)
 {
 }
 
-CutProc::~CutProc() {}
+CutProc::CutProc()
+: params(NULL)
+, random(NULL)
+{
+}
 
-void CutProc::SetMinAmp(float v) { minamp = v;}
-void CutProc::SetMaxAmp(float v) { maxamp = v;}
-void CutProc::SetMinPan(float v) { minpan = v;}
-void CutProc::SetMaxPan(float v) { maxpan = v;}
-void CutProc::SetMinDetune(float v) { mindetune = v;}
-void CutProc::SetMaxDetune(float v) { maxdetune = v;}
-void CutProc::SetDutyCycle(float v) { dutycycle = v;}
-void CutProc::SetFillDutyCycle(float v) { filldutycycle = v;}
-void CutProc::SetMinPhraseLength(long v) { minphraselength = v;}
-void CutProc::SetMaxPhraseLength(long v) { maxphraselength = v;}
+void CutProc::SetParams(const CutParams *p) { params = p;}
+void CutProc::SetRandom(CounterRandom *r) { random = r;}
 
 long CutProc::ChoosePhraseLength()
 {
-  return Math::randominteger(minphraselength,maxphraselength);
+  return Math::randominteger(*random,params->minphraselength,params->maxphraselength);
 }
 
-void CutProc::ChooseCuts(std::vector<CutInfo> &cuts,
-                         long &unitsinblock,
-                         long unitsdone,
-                         long totalunits,
-                         long subdiv,
-                         double spu)
+long CutProc::MaxPhraseLength() const
 {
+  return std::max(params->minphraselength,params->maxphraselength);
 }
 
 //-------------------------------------------------------------------------------
 long CutProc11::ChooseRepeats()
 {
-  return Math::randominteger(minrepeats,maxrepeats);
+  return Math::randominteger(*random,minrepeats,maxrepeats);
 }
 
 long CutProc11::ChooseUnitsInCut(long subdiv)
 {	// units = 2*x+1 , x is natural // 1 <= 2*x + 1 <= subdiv/2+1
-  return 2*long(Math::randomfloat(0.f, float(subdiv)/4.f)+0.5f) + 1;
+  return 2*long(Math::randomfloat(*random,0.f, float(subdiv)/4.f)+0.5f) + 1;
 }
 
 CutProc11::CutProc11()
@@ -94,7 +88,7 @@ void CutProc11::SetStutterArea(float v) { stutterarea = v;}
 void CutProc11::SetMinRepeats(long v) { minrepeats = v+1;} //not repeats actually but occurences
 void CutProc11::SetMaxRepeats(long v) { maxrepeats = v+1;}
 
-void CutProc11::ChooseCuts(std::vector<CutInfo> &cuts,
+void CutProc11::ChooseCuts(CutList &cuts,
                            long &unitsinblock,
                            long unitsdone,
                            long totalunits,
@@ -106,28 +100,29 @@ void CutProc11::ChooseCuts(std::vector<CutInfo> &cuts,
   long repeats = 1;
   
   if( float(unitsleft)/float(subdiv) < stutterarea &&
-     Math::randomfloat(0.0, 1.0) < stutterchance) //end of phrase stutter
+     Math::randomfloat(*random,0.0, 1.0) < stutterchance) //end of phrase stutter
   {
-    long numbers[] = { 1, 2, 3, 4, 6, 8 };
-    double probs[]  = { 0.4, 0.3, 0.1, 0.1, 0.05, 0.05 };
-    long multiplier = Math::wchoose(numbers,probs,6);
+    static const long numbers[] = { 1, 2, 3, 4, 6, 8 };
+    static constexpr double probs[]  = { 0.4, 0.3, 0.1, 0.1, 0.05, 0.05 };
+    static constexpr AliasTable<6> multipliers(probs);
+    long multiplier = multipliers.Choose(*random,numbers);
     repeats=unitsleft*multiplier;
     double unitsinthiscut= 1.0/multiplier;
     unitsinblock = repeats*unitsinthiscut;
     cuts.resize(repeats);
-    const float startpan    = Math::randomfloat(minpan,maxpan);
-    const float endpan      = Math::randomfloat(minpan,maxpan);
-    const float startamp    = Math::randomfloat(minamp,maxamp);
-    const float endamp      = Math::randomfloat(minamp,maxamp);
+    const float startpan    = Math::randomfloat(*random,params->minpan,params->maxpan);
+    const float endpan      = Math::randomfloat(*random,params->minpan,params->maxpan);
+    const float startamp    = Math::randomfloat(*random,params->minamp,params->maxamp);
+    const float endamp      = Math::randomfloat(*random,params->minamp,params->maxamp);
     const float startdetune = 0.f;
-    const float enddetune   = Math::randomfloat(mindetune,maxdetune);
+    const float enddetune   = Math::randomfloat(*random,params->mindetune,params->maxdetune);
     
-    for(int i=0;i<repeats;i++)
+    for(int i=0;i<cuts.size();i++)
     {
       const float phase = float(i)/float(repeats);
       const long cutlength = long(unitsinthiscut*spu);
       cuts[i].size = cutlength;
-      cuts[i].length = long(float(cutlength)*filldutycycle);
+      cuts[i].length = long(float(cutlength)*params->filldutycycle);
       cuts[i].pan = startpan + (endpan-startpan)*phase;
       cuts[i].amp = startamp + (endamp-startamp)*phase;
       cuts[i].cents = startdetune + (enddetune-startdetune)*phase;
@@ -160,13 +155,13 @@ void CutProc11::ChooseCuts(std::vector<CutInfo> &cuts,
     }
     unitsinblock = repeats*unitsincut;
     cuts.resize(repeats);
-    for(int i=0;i<repeats;i++)
+    for(int i=0;i<cuts.size();i++)
     {
       cuts[i].size = long(unitsincut*spu);
       //quantize cut dutycycle to match cuts to units
       //cuts[i].length = long(double(std::max(long(dutycycle*unitsincut),1L))*spu);
-      cuts[i].length = long(dutycycle*unitsincut*spu);
-      cuts[i].amp = Math::randomfloat(minamp,maxamp);
+      cuts[i].length = long(params->dutycycle*unitsincut*spu);
+      cuts[i].amp = Math::randomfloat(*random,params->minamp,params->maxamp);
     }
   }
 }
@@ -177,16 +172,17 @@ long WarpCutProc::ChooseRepeats(float beatsinblock)
   long repeatsarray[] = {4,8,16,32};
   
   if(beatsinblock<1.f)
-    return repeatsarray[Math::randominteger(0,2)];
+    return repeatsarray[Math::randominteger(*random,0,2)];
   else
-    return repeatsarray[Math::randominteger(1,3)];
+    return repeatsarray[Math::randominteger(*random,1,3)];
 }
 
 long WarpCutProc::ChooseBlockSize()
 {
-  long blockarray[] = {1,2,4};
-  double blockprobs[]  = {0.5,0.4,0.1};
-  return Math::wchoose(blockarray,blockprobs,3);
+  static const long blockarray[] = {1,2,4};
+  static constexpr double blockprobs[]  = {0.5,0.4,0.1};
+  static constexpr AliasTable<3> blocksizes(blockprobs);
+  return blocksizes.Choose(*random,blockarray);
 }
 
 WarpCutProc::WarpCutProc()
@@ -202,7 +198,7 @@ void WarpCutProc::SetRegularChance(float chance) { regularchance = chance;}
 void WarpCutProc::SetRitardChance(float chance) { ritardchance = chance;}
 void WarpCutProc::SetAccel(float v) { accel = v;}
 
-void WarpCutProc::ChooseCuts(std::vector<CutInfo> &cuts,
+void WarpCutProc::ChooseCuts(CutList &cuts,
                              long &unitsinblock,
                              long unitsdone,
                              long totalunits,
@@ -215,41 +211,41 @@ void WarpCutProc::ChooseCuts(std::vector<CutInfo> &cuts,
   if(unitsinblock>unitsleft)
     unitsinblock = unitsleft;
   
-  if(Math::randomfloat(0.0, 1.0)< straightchance)
+  if(Math::randomfloat(*random,0.0, 1.0)< straightchance)
   {
     double temp = double(unitsinblock)/double(repeats);
     cuts.resize(repeats);
-    for(int i=0;i<repeats;i++)
+    for(int i=0;i<cuts.size();i++)
     {
       long l = long(spu*temp);
       cuts[i].size = l;
       //quantize cut dutycycle to match cuts to units
-      cuts[i].length = long(double(std::max(long(dutycycle*temp),1L))*spu);
-      cuts[i].amp = Math::randomfloat(minamp,maxamp);
+      cuts[i].length = long(double(std::max(long(params->dutycycle*temp),1L))*spu);
+      cuts[i].amp = Math::randomfloat(*random,params->minamp,params->maxamp);
     }
   }
   else
   {
     repeats = ChooseRepeats(float(unitsinblock)/float(subdiv));
-    const float startpan    = Math::randomfloat(minpan,maxpan);
-    const float endpan      = Math::randomfloat(minpan,maxpan);
-    const float startamp    = Math::randomfloat(minamp,maxamp);
-    const float endamp      = Math::randomfloat(minamp,maxamp);
-    const float startdetune = 0.f; //Math::randomfloat(mindetune,maxdetune);
-    const float enddetune   = Math::randomfloat(mindetune,maxdetune);
+    const float startpan    = Math::randomfloat(*random,params->minpan,params->maxpan);
+    const float endpan      = Math::randomfloat(*random,params->minpan,params->maxpan);
+    const float startamp    = Math::randomfloat(*random,params->minamp,params->maxamp);
+    const float endamp      = Math::randomfloat(*random,params->minamp,params->maxamp);
+    const float startdetune = 0.f; //Math::randomfloat(*random,mindetune,maxdetune);
+    const float enddetune   = Math::randomfloat(*random,params->mindetune,params->maxdetune);
     
-    if(Math::randomfloat(0.0, 1.0)< regularchance)
+    if(Math::randomfloat(*random,0.0, 1.0)< regularchance)
     {
       //long repeatsarray[] = {4,6,8,12,16,18,24,32};
-      //repeats = repeatsarray[Math::randominteger(0,7)];
+      //repeats = repeatsarray[Math::randominteger(*random,0,7)];
       double temp = double(unitsinblock)/double(repeats);
       cuts.resize(repeats);
-      for(int i=0;i<repeats;i++)
+      for(int i=0;i<cuts.size();i++)
       {
         const float phase = float(i)/float(repeats);
         long l = long(spu*temp+0.5);
         cuts[i].size = l;
-        cuts[i].length = long(float(l)*filldutycycle);
+        cuts[i].length = long(float(l)*params->filldutycycle);
         cuts[i].pan = startpan + (endpan-startpan)*phase;
         cuts[i].amp = startamp + (endamp-startamp)*phase;
         cuts[i].cents = startdetune + (enddetune-startdetune)*phase;
@@ -259,30 +255,99 @@ void WarpCutProc::ChooseCuts(std::vector<CutInfo> &cuts,
     {
       double temp = unitsinblock*(1.0-double(accel))/(1.0-pow(double(accel),double(repeats)));
       cuts.resize(repeats);
-      for(int i=0;i<repeats;i++)
+      for(int i=0;i<cuts.size();i++)
       {
         const float phase = float(i)/float(repeats);
         long l = long(spu*temp*(pow(double(accel),double(i))));
         cuts[i].size = l;
-        cuts[i].length = long(float(l)*filldutycycle);
+        cuts[i].length = long(float(l)*params->filldutycycle);
         cuts[i].pan = startpan + (endpan-startpan)*phase;
         cuts[i].amp = startamp + (endamp-startamp)*phase;
         cuts[i].cents = startdetune + (enddetune-startdetune)*phase;
       }
-      if(Math::randomfloat(0.0, 1.0)< ritardchance)
+      if(Math::randomfloat(*random,0.0, 1.0)< ritardchance)
         std::reverse(cuts.begin(),cuts.end());
     }
   }
 }
 
 //-------------------------------------------------------------------------------
+// the fills of SQPusher: a fill is a run of blocks, a block a run of cut
+// durations in beats. flat read-only tables shared by all instances
+struct FillSpan
+{
+  unsigned char start,length;
+};
+
+static constexpr double fillbeats[] =
+{
+  0.75,0.75,0.75,0.75, 1.0,                                 // 0
+  0.5,1.0, 1.0, 1.0,0.5,                                    // 1
+  0.5, 1.0,1.0,1.0, 0.5,                                    // 2
+  0.571429, 0.571429,0.571429, 0.571429,0.571429, 0.571429,
+  0.285714,0.285716,                                        // 3
+  1.0,0.5, 1.0,0.5, 0.5,0.5,                                // 4
+  0.5,0.5, 0.66,0.67,0.67, 1.0,                             // 5
+  0.34, 0.33,0.33,2.33, 0.34,0.33,                          // 6
+  1.4, 0.4,0.4, 0.6,0.2, 1.0,                               // 7
+  0.167,0.167,0.166,1.0,1.0,0.5, 1.0,                       // 8
+  1.5,0.5,1.0, 0.25,0.25,0.25,0.25,                         // 9
+  0.2,0.2, 0.4,0.4, 0.4,0.4, 2.0,                           // 10
+  0.75,0.75,1.0, 0.25,0.25,0.25,0.25,0.25,0.25,             // 11
+  0.5,1.0, 0.5, 0.125,0.125,0.125,0.125, 1.0, 0.167,0.167,0.166 // 12
+};
+
+// empty blocks keep the cuts of the block before
+static constexpr FillSpan fillblocks[] =
+{
+  {0,4},{4,1},                                              // 0
+  {5,2},{7,1},{8,2},                                        // 1
+  {10,1},{11,3},{14,1},                                     // 2
+  {15,1},{16,2},{18,2},{20,1},{21,2},                       // 3
+  {23,2},{25,2},{27,2},                                     // 4
+  {29,2},{31,3},{34,1},                                     // 5
+  {35,1},{36,3},{39,2},{41,0},                              // 6
+  {41,1},{42,2},{44,2},{46,1},                              // 7
+  {47,6},{53,1},{54,0},                                     // 8
+  {54,3},{57,4},                                            // 9
+  {61,2},{63,2},{65,2},{67,1},                              // 10
+  {68,3},{71,6},                                            // 11
+  {77,2},{79,1},{80,4},{84,1},{85,3}                        // 12
+};
+
+static constexpr FillSpan fills[] =
+{
+  {0,2},{2,3},{5,3},{8,5},{13,3},{16,3},{19,4},{23,4},{27,3},{30,2},{32,4},{36,2},{38,5}
+};
+
+static constexpr long numfills = sizeof(fills)/sizeof(fills[0]);
+
+// every block starts where the one before ends, and so does every fill
+static constexpr bool FillsAreContiguous()
+{
+  long block = 0, beat = 0;
+  for(long i=0;i<numfills;i++)
+  {
+    if(fills[i].start != block)
+      return false;
+    for(long j=0;j<fills[i].length;j++,block++)
+    {
+      if(fillblocks[block].start != beat)
+        return false;
+      beat += fillblocks[block].length;
+    }
+  }
+  return block == long(sizeof(fillblocks)/sizeof(fillblocks[0]))
+      && beat == long(sizeof(fillbeats)/sizeof(fillbeats[0]));
+}
+static_assert(FillsAreContiguous(),"fill tables out of step");
+
 SQPusherCutProc::SQPusherCutProc()
 : activity(0.1)
 , fill(false)
 , fillnumber(0)
 , fillpos(0)
 {
-  sqpusherinit();
 }
 
 void SQPusherCutProc::SetActivity(float v)
@@ -290,88 +355,13 @@ void SQPusherCutProc::SetActivity(float v)
   activity=v;
 }
 
-void SQPusherCutProc::sqpusherinit()
-{
-  //boring manual initialisation
-  cs.resize(13);
-  
-  cs[0].resize(2);
-  cs[0][0].push_back(0.75);cs[0][0].push_back(0.75);cs[0][0].push_back(0.75);cs[0][0].push_back(0.75);
-  cs[0][1].push_back(1.0);
-  
-  cs[1].resize(3);
-  cs[1][0].push_back(0.5);cs[1][0].push_back(1.0);
-  cs[1][1].push_back(1.0);
-  cs[1][2].push_back(1.0);cs[1][2].push_back(0.5);
-  
-  cs[2].resize(3);
-  cs[2][0].push_back(0.5);
-  cs[2][1].push_back(1.0); cs[2][1].push_back(1.0); cs[2][1].push_back(1.0);
-  cs[2][2].push_back(0.5);
-  
-  cs[3].resize(5);
-  cs[3][0].push_back(0.571429 );
-  cs[3][1].push_back(0.571429 );  cs[3][1].push_back(0.571429 );
-  cs[3][2].push_back(0.571429 );  cs[3][2].push_back(0.571429 );
-  cs[3][3].push_back(0.571429 );
-  cs[3][4].push_back(0.285714 );  cs[3][4].push_back(0.285716 );
-  
-  cs[4].resize(3);
-  cs[4][0].push_back(1.0); cs[4][0].push_back(0.5);
-  cs[4][1].push_back(1.0); cs[4][1].push_back(0.5);
-  cs[4][2].push_back(0.5); cs[4][2].push_back(0.5);
-  
-  cs[5].resize(3);
-  cs[5][0].push_back(0.5);cs[5][0].push_back(0.5);
-  cs[5][1].push_back(0.66);cs[5][1].push_back(0.67); cs[5][1].push_back(0.67);
-  cs[5][2].push_back(1.0);
-  
-  cs[6].resize(4);
-  cs[6][0].push_back(0.34);
-  cs[6][1].push_back(0.33);  cs[6][1].push_back(0.33);
-  cs[6][2].push_back(0.34);  cs[6][2].push_back(0.33);
-  cs[6][1].push_back(2.33);
-  
-  cs[7].resize(4);
-  cs[7][0].push_back(1.4);
-  cs[7][1].push_back(0.4);cs[7][1].push_back(0.4);
-  cs[7][2].push_back(0.6);cs[7][2].push_back(0.2);
-  cs[7][3].push_back(1.0);
-  
-  cs[8].resize(3);
-  cs[8][0].push_back(0.167);cs[8][0].push_back(0.167);cs[8][0].push_back(0.166);
-  cs[8][1].push_back(1.0);cs[8][0].push_back(1.0);cs[8][0].push_back(1.0);
-  cs[8][0].push_back(0.5);
-  
-  cs[9].resize(2);
-  cs[9][0].push_back(1.5);  cs[9][0].push_back(0.5);  cs[9][0].push_back(1.0);
-  cs[9][1].push_back(0.25); cs[9][1].push_back(0.25); cs[9][1].push_back(0.25); cs[9][1].push_back(0.25);
-  
-  cs[10].resize(4);
-  cs[10][0].push_back(0.2);cs[10][0].push_back(0.2);
-  cs[10][1].push_back(0.4);cs[10][1].push_back(0.4);
-  cs[10][2].push_back(0.4);cs[10][2].push_back(0.4);
-  cs[10][3].push_back(2.0);
-  
-  cs[11].resize(2);
-  cs[11][0].push_back(0.75);cs[11][0].push_back(0.75);cs[11][0].push_back(1.0);
-  cs[11][1].push_back(0.25);cs[11][1].push_back(0.25);cs[11][1].push_back(0.25);cs[11][1].push_back(0.25);cs[11][1].push_back(0.25);cs[11][1].push_back(0.25);
-  
-  cs[12].resize(5);
-  cs[12][0].push_back(0.5);cs[12][0].push_back(1.0);
-  cs[12][1].push_back(0.5);
-  cs[12][2].push_back(0.125);cs[12][2].push_back(0.125);cs[12][2].push_back(0.125);cs[12][2].push_back(0.125);
-  cs[12][3].push_back(1.0);
-  cs[12][4].push_back(0.167); cs[12][4].push_back(0.167); cs[12][4].push_back(0.166);
-}
-
 long SQPusherCutProc::ChoosePhraseLength()
 {
   fill = false;
   return CutProc::ChoosePhraseLength();
 }
 
-void SQPusherCutProc::ChooseCuts(std::vector<CutInfo> &cuts,
+void SQPusherCutProc::ChooseCuts(CutList &cuts,
                                  long &unitsinblock,
                                  long unitsdone,
                                  long totalunits,
@@ -393,30 +383,30 @@ void SQPusherCutProc::ChooseCuts(std::vector<CutInfo> &cuts,
   if((totalunits-unitsdone) == subdiv)
   {
     fill = true;
-    fillnumber = Math::randominteger(0,12);
+    fillnumber = Math::randominteger(*random,0,numfills-1);
     fillpos=0;
   }
   
   if(fill==true)
   {
-    if(fillpos<cs[fillnumber].size())
+    if(fillpos<fills[fillnumber].length)
     {
-      cuts.resize(cs[fillnumber][fillpos].size());
+      const FillSpan &block = fillblocks[fills[fillnumber].start+fillpos];
+      const double *beats = fillbeats+block.start;
+      cuts.resize(block.length);
       double beatsdone = 0.0;
       for(int i=0;i<cuts.size();i++)
       {
-        const float phase = float(i)/float(cuts.size());
-        beatsdone += cs[fillnumber][fillpos][i];
-        long l = long(spb * cs[fillnumber][fillpos][i]);
+        beatsdone += beats[i];
+        long l = long(spb * beats[i]);
         cuts[i].size = l;
-        cuts[i].length = long(spb * cs[fillnumber][fillpos][i] * filldutycycle);
-        cuts[i].pan = Math::randomfloat(minpan,maxpan);
-        cuts[i].amp = Math::randomfloat(minamp,maxamp);
-        cuts[i].cents = Math::randomfloat(mindetune,maxdetune);
+        cuts[i].length = long(spb * beats[i] * params->filldutycycle);
+        cuts[i].pan = Math::randomfloat(*random,params->minpan,params->maxpan);
+        cuts[i].amp = Math::randomfloat(*random,params->minamp,params->maxamp);
+        cuts[i].cents = Math::randomfloat(*random,params->mindetune,params->maxdetune);
       }
-      unitsdone = long(double(subdiv)*beatsdone/4.0);
-      if(unitsinblock>unitsleft)
-        unitsinblock=unitsleft; //will automatically interrupt cutsequence before its end
+      // a fill block lasts as long as its cuts, so fills never depend on the phrase before
+      unitsinblock = std::max(std::min(long(double(subdiv)*beatsdone/4.0+0.5),unitsleft),1L);
       fillpos++;
       return;
     }
@@ -428,7 +418,7 @@ void SQPusherCutProc::ChooseCuts(std::vector<CutInfo> &cuts,
   }
   
   {
-    long temp = 1 + 2*Math::randominteger(0,1);
+    long temp = 1 + 2*Math::randominteger(*random,0,1);
     if(beatpos == 2)
       temp=1;
     
@@ -436,17 +426,17 @@ void SQPusherCutProc::ChooseCuts(std::vector<CutInfo> &cuts,
     if(unitsinblock>unitsleft)
       unitsinblock=unitsleft; //will automatically interrupt cutsequence before its end
     
-    if(Math::randomfloat(0.0,1.0) < sqchance) // 2*temp semiquaver
+    if(Math::randomfloat(*random,0.0,1.0) < sqchance) // 2*temp semiquaver
     {
       cuts.resize(temp*2);
       for(int i=0;i<cuts.size();i++)
       {
         long l = long(0.25*spb);
         cuts[i].size = l;
-        cuts[i].pan = Math::randomfloat(minpan,maxpan);
-        cuts[i].amp = Math::randomfloat(minamp,maxamp);
-        cuts[i].cents = Math::randomfloat(mindetune,maxdetune);
-        cuts[i].length = long(0.25*spb*dutycycle);
+        cuts[i].pan = Math::randomfloat(*random,params->minpan,params->maxpan);
+        cuts[i].amp = Math::randomfloat(*random,params->minamp,params->maxamp);
+        cuts[i].cents = Math::randomfloat(*random,params->mindetune,params->maxdetune);
+        cuts[i].length = long(0.25*spb*params->dutycycle);
       }
     }
     else            // or temp quaver i.e same duration
@@ -456,14 +446,150 @@ void SQPusherCutProc::ChooseCuts(std::vector<CutInfo> &cuts,
       {
         long l = long(0.5*spb);
         cuts[i].size = l;
-        cuts[i].amp = Math::randomfloat(minamp,maxamp);
-        cuts[i].cents = Math::randomfloat(mindetune,maxdetune);
-        cuts[i].length = long(0.5*spb*dutycycle);
+        cuts[i].amp = Math::randomfloat(*random,params->minamp,params->maxamp);
+        cuts[i].cents = Math::randomfloat(*random,params->mindetune,params->maxdetune);
+        cuts[i].length = long(0.5*spb*params->dutycycle);
       }
     }
   }
 }
 
+//-------------------------------------------------------------------------------
+PatternCutProc::PatternCutProc()
+: pattern(NULL)
+, fill(-1)
+, fillpos(0)
+{
+}
+
+void PatternCutProc::SetPattern(const CutPattern *p)
+{
+  pattern = p;
+  fill = -1;
+}
+
+long PatternCutProc::Choose(const CutPattern::Span &span, long fallback)
+{
+  if(span.length == 0)
+    return fallback;
+  const long i = AliasIndex(*random,pattern->aliasprob.data()+span.start,
+                           pattern->alias.data()+span.start,span.length);
+  return long(pattern->choices[span.start+i]);
+}
+
+void PatternCutProc::LimitCuts(CutList &cuts) const
+{
+  if(params->maxcutlength <= 0)
+    return;
+  for(long i=0;i<cuts.size();i++)
+  {
+    cuts[i].size = std::min(cuts[i].size,params->maxcutlength);
+    cuts[i].length = std::min(cuts[i].length,params->maxcutlength);
+  }
+}
+
+long PatternCutProc::ChoosePhraseLength()
+{
+  fill = -1;
+  if(pattern->phrases.length == 0)
+    return CutProc::ChoosePhraseLength();
+  return Choose(pattern->phrases,1);
+}
+
+long PatternCutProc::MaxPhraseLength() const
+{
+  if(pattern->phrases.length == 0)
+    return CutProc::MaxPhraseLength();
+  long longest = 1;
+  for(long i=0;i<pattern->phrases.length;i++)
+    longest = std::max(longest,long(pattern->choices[pattern->phrases.start+i]));
+  return longest;
+}
+
+void PatternCutProc::ChooseCuts(CutList &cuts,
+                                long &unitsinblock,
+                                long unitsdone,
+                                long totalunits,
+                                long subdiv,
+                                double spu)
+{
+  const long unitsleft = totalunits-unitsdone;
+  
+  // as SQPusher, a fill starts on the last bar of the phrase
+  if(unitsleft == subdiv && !pattern->fills.empty())
+  {
+    fill = Math::randominteger(*random,0,long(pattern->fills.size())-1);
+    fillpos = 0;
+  }
+  
+  if(fill >= 0 && fillpos < pattern->fills[fill].length)
+  {
+    const CutPattern::Span &block = pattern->fillblocks[pattern->fills[fill].start+fillpos];
+    const double *beats = pattern->fillbeats.data()+block.start;
+    const double spb = spu*double(subdiv)/4.0;
+    cuts.resize(block.length);
+    double beatsdone = 0.0;
+    for(long i=0;i<cuts.size();i++)
+    {
+      beatsdone += beats[i];
+      cuts[i].size = long(spb*beats[i]);
+      cuts[i].length = long(spb*beats[i]*params->filldutycycle);
+      cuts[i].pan = Math::randomfloat(*random,params->minpan,params->maxpan);
+      cuts[i].amp = Math::randomfloat(*random,params->minamp,params->maxamp);
+      cuts[i].cents = Math::randomfloat(*random,params->mindetune,params->maxdetune);
+    }
+    unitsinblock = std::max(std::min(long(double(subdiv)*beatsdone/4.0+0.5),unitsleft),1L);
+    LimitCuts(cuts);
+    fillpos++;
+    return;
+  }
+  
+  unitsinblock = std::max(std::min(Choose(pattern->blocks,1),unitsleft),1L);
+  cuts.resize(Choose(pattern->repeats,1));
+  const long repeats = cuts.size();
+  const double cutsize = double(unitsinblock)*spu/double(repeats);
+  
+  if(Math::randomfloat(*random,0.0,1.0) < pattern->rampchance)
+  {
+    const float startpan    = Math::randomfloat(*random,params->minpan,params->maxpan);
+    const float endpan      = Math::randomfloat(*random,params->minpan,params->maxpan);
+    const float startamp    = Math::randomfloat(*random,params->minamp,params->maxamp);
+    const float endamp      = Math::randomfloat(*random,params->minamp,params->maxamp);
+    const float startdetune = Math::randomfloat(*random,params->mindetune,params->maxdetune);
+    const float enddetune   = Math::randomfloat(*random,params->mindetune,params->maxdetune);
+    
+    double size = cutsize;
+    for(long i=0;i<repeats;i++)
+    {
+      const float phase = float(i)/float(repeats);
+      cuts[i].size = long(size);
+      cuts[i].length = long(size*params->filldutycycle);
+      cuts[i].pan = startpan + (endpan-startpan)*phase;
+      cuts[i].amp = startamp + (endamp-startamp)*phase;
+      cuts[i].cents = startdetune + (enddetune-startdetune)*phase;
+      size *= pattern->rampfactor;
+    }
+  }
+  else
+  {
+    for(long i=0;i<repeats;i++)
+    {
+      cuts[i].size = long(cutsize);
+      cuts[i].length = long(cutsize*params->dutycycle);
+      cuts[i].amp = Math::randomfloat(*random,params->minamp,params->maxamp);
+    }
+  }
+  
+  // a lookback block replays the input from that many units before it
+  if(pattern->lookbacks.length > 0 && Math::randomfloat(*random,0.0,1.0) < pattern->lookbackchance)
+  {
+    const long offset = -long(double(Choose(pattern->lookbacks,0))*spu);
+    for(long i=0;i<repeats;i++)
+      cuts[i].offset = offset;
+  }
+  LimitCuts(cuts);
+}
+
 //-------------------------------------------------------------------------------
 
 ListenerManager::ListenerManager()	{}
@@ -506,51 +632,102 @@ void ListenerManager::RegisterListener(BBCutListener *l)
 }
 
 //------------------------------------------------------------------------
-LivePlayer::LivePlayer()
-: currentcut(0)
+LivePlayerBase::LivePlayerBase()
+: numchannels(0)
+, capacity(0)
+, capturelength(0)
+, currentcut(0)
 , inputindex(0)
 , readindex(0)
-, ll(0.f)
-, lr(0.f)
-, rl(0.f)
-, rr(0.f)
-, fade(1)
-, L(&inputbufferL)
-, R(&inputbufferR)
+, historysize(0)
+, writeindex(0)
+, blockstart(0)
+, cutstart(0)
+, cutoffset(0)
+, amp(0.f)
+, ratio(1.0)
 , listenermanager(NULL)
 {
-	inputbufferL.reserve (48000);
-	inputbufferR.reserve (48000);
-	pitchedbufferL.reserve (48000);
-	pitchedbufferR.reserve (48000);
+  tail.start = tail.pos = tail.done = tail.left = tail.captured = 0;
+  tail.ratio = 1.0;
+  std::vector<long> stereo;
+  stereo.push_back(1);
+  stereo.push_back(0);
+  SetChannelPairs(stereo);
 }
 
-void LivePlayer::SetListenerManager(ListenerManager *lm)
+void LivePlayerBase::SetListenerManager(ListenerManager *lm)
 {
   listenermanager = lm;
 }
 
-void LivePlayer::SetFade(float v)
+void LivePlayerBase::SetFade(float v)
 {
   if(v<1.f) v = 1.f ; //0.1f;
-  fade = v;
+  envelope.SetFade(v);
+}
+
+void LivePlayerBase::SetEnvelopeShape(long v)
+{
+  envelope.SetShape(v);
+}
+
+void LivePlayerBase::SetResamplerQuality(long v)
+{
+  resampler.SetQuality(v);
+}
+
+void LivePlayerBase::SetCrossfade(bool v)
+{
+  envelope.SetOverlap(v);
+  if(!v)
+    tail.left = 0;
+}
+
+void LivePlayerBase::SetChannelPairs(const std::vector<long> &partners)
+{
+  numchannels = partners.size();
+  partner = partners;
+  for(long c=0;c<numchannels;c++)
+  {
+    if(partner[c]<0 || partner[c]>=numchannels)
+      partner[c] = c;
+  }
+  selfgain.assign(numchannels,0.f);
+  crossgain.assign(numchannels,0.f);
+  tail.selfgain.assign(numchannels,0.f);
+  tail.crossgain.assign(numchannels,0.f);
+  tail.left = 0;
+  UpdateGains();
+}
+
+void LivePlayerBase::Prepare(long maxcuts, long maxcutlength)
+{
+  cuts.reserve(maxcuts);
+  nextcuts.reserve(maxcuts);
+  envelope.Prepare(maxcutlength);
+  resampler.Prepare();
+  capacity = maxcutlength;
+  capturelength = std::min(capturelength,maxcutlength);
+  historysize = 1;
+  while(historysize<kHistoryBars*capacity+kGuard)
+    historysize <<= 1;
+  inputindex = 0;
+  writeindex = blockstart = cutstart = 0;
+  tail.left = 0;
+  currentcut = cuts.size();
 }
 
-void LivePlayer::OnBlock(std::vector<CutInfo> newcuts)
+void LivePlayerBase::OnBlock()
 {
-  if(!newcuts.empty())
+  if(!nextcuts.empty())
   {
-    cuts = newcuts;
-    //rotation matrix
-    // [ll lr]
-    // [rl rr]
-    const float pan = cuts[0].pan;
-    const float amp = cuts[0].amp;
-    ll = amp * ((pan<0)? 1.f :  cos(pan*2*pi_4));
-    lr = amp * ((pan<0)? 0.f :  sin(pan*2*pi_4));
-    rl = amp * ((pan>0)? 0.f : -sin(pan*2*pi_4));
-    rr = amp * ((pan>0)? 1.f :  cos(pan*2*pi_4));
+    std::swap(cuts,nextcuts);
+    StartCut(cuts[0]);
+    ratio = 1.0; //nothing captured yet, the first cut is played as is
     inputindex = readindex = 0;
+    blockstart = writeindex;
+    cutstart = (blockstart+cutoffset) & (historysize-1);
     currentcut=0;
     
     // tell cut-synchrone effects
@@ -563,24 +740,741 @@ void LivePlayer::OnBlock(std::vector<CutInfo> newcuts)
       if(cuts[i].size>maxcutlength)
         maxcutlength = cuts[i].size;
     
-    inputbufferL.resize(maxcutlength,0.f);
-    inputbufferR.resize(maxcutlength,0.f);
-    pitchedbufferL.resize(maxcutlength,0.f);
-    pitchedbufferR.resize(maxcutlength,0.f);
-    L = &inputbufferL;
-    R = &inputbufferR;
+    //cuts longer than the longest block play silence past its end
+    capturelength = std::min(maxcutlength,capacity);
+  }
+}
+
+void LivePlayerBase::Resume(long elapsed)
+{
+  const long lookback = historysize-capacity-kGuard;
+  elapsed = std::min(elapsed,lookback);
+  if(cuts.empty() || elapsed <= 0)
+    return;
+  
+  long pos = elapsed;
+  currentcut = 0;
+  while(currentcut<cuts.size() && pos>=cuts[currentcut].size)
+    pos -= cuts[currentcut++].size;
+  blockstart = (writeindex-elapsed) & (historysize-1);
+  inputindex = elapsed;
+  readindex = 0;
+  if(currentcut>=cuts.size())
+    return; // silent to the end of the block
+  
+  // the rest of the cut as a cut of its own
+  CutInfo &cut = cuts[currentcut];
+  StartCut(cut);
+  if(currentcut==0)
+    ratio = 1.0; // as in OnBlock()
+  const long shift = long(double(pos)*ratio);
+  cut.size -= pos;
+  cut.length = std::max(cut.length-pos,0L);
+  envelope.Start(cut.length);
+  cutoffset += shift;
+  cutstart = (blockstart+cutoffset) & (historysize-1);
+  
+  if(listenermanager)
+    listenermanager->OnCut(currentcut,cuts.size());
+}
+
+long LivePlayerBase::LiveHistory() const
+{
+  const long mask = historysize-1;
+  const long lookback = historysize-capacity-kGuard;
+  const long sinceblock = (writeindex-blockstart) & mask;
+  long back = 0;
+  for(long i=currentcut;i<long(cuts.size());i++)
+    back = std::max(back,sinceblock-std::max(-lookback,std::min(cuts[i].offset,0L)));
+  if(tail.left>0)
+    back = std::max(back,(writeindex-tail.start) & mask);
+  return back;
+}
+
+void LivePlayerBase::StartCut(const CutInfo &cut)
+{
+  matrix.Set(cut.amp,cut.pan);
+  amp = cut.amp;
+  
+  // past offsets read the history in place, as far back as it is kept
+  const long lookback = historysize-capacity-kGuard;
+  cutoffset = std::max(-lookback,std::min(cut.offset,0L));
+  cutstart = (blockstart+cutoffset) & (historysize-1);
+  UpdateGains();
+  
+  envelope.Start(cut.length);
+  
+  //detuned cuts are resampled while they are read
+  ratio = (fabs(cut.cents) > 1e-10)? pow(2.0,cut.cents/1200.0) : 1.0;
+  resampler.SetRatio(ratio);
+}
+
+void LivePlayerBase::UpdateGains()
+{
+  // the same cut plan on all channels, each pair rotated alike
+  for(long c=0;c<numchannels;c++)
+  {
+    const long p = partner[c];
+    if(p==c)
+    {
+      selfgain[c] = amp;
+      crossgain[c] = 0.f;
+    }
+    else if(c<p)
+    {
+      selfgain[c] = matrix.ll;
+      crossgain[c] = matrix.rl;
+    }
+    else
+    {
+      selfgain[c] = matrix.rr;
+      crossgain[c] = matrix.lr;
+    }
+  }
+}
+
+void LivePlayerBase::StartTail(long pos)
+{
+  tail.start = cutstart;
+  tail.pos = pos;
+  tail.done = 0;
+  tail.left = envelope.TailLength();
+  tail.captured = inputindex-cutoffset;
+  tail.ratio = ratio;
+  std::copy(selfgain.begin(),selfgain.end(),tail.selfgain.begin());
+  std::copy(crossgain.begin(),crossgain.end(),tail.crossgain.begin());
+}
+
+void LivePlayerBase::NextCut()
+{
+  currentcut++;
+  readindex = 0;
+  if(currentcut>=cuts.size())
+    return;
+  
+  StartCut(cuts[currentcut]);
+  
+  // tell cut-synchrone effects
+  if(listenermanager)
+    listenermanager->OnCut(currentcut,cuts.size()); // allow interpolation...
+}
+
+template<class T>
+void LivePlayer<T>::SetChannelPairs(const std::vector<long> &partners)
+{
+  LivePlayerBase::SetChannelPairs(partners);
+  Allocate();
+}
+
+template<class T>
+void LivePlayer<T>::Prepare(long maxcuts, long maxcutlength)
+{
+  LivePlayerBase::Prepare(maxcuts,maxcutlength);
+  Allocate();
+}
+
+template<class T>
+void LivePlayer<T>::Allocate()
+{
+  history.assign(numchannels*(historysize+kGuard),T(0));
+  chunk.assign(numchannels*kChunk,T(0));
+}
+
+template<class T>
+void LivePlayer<T>::Write(const T *const *in, long offset, long n)
+{
+  const long first = std::min(n,historysize-writeindex);
+  for(long c=0;c<numchannels;c++)
+  {
+    T *x = Channel(c);
+    std::copy(in[c]+offset,in[c]+offset+first,x+writeindex);
+    std::copy(in[c]+offset+first,in[c]+offset+n,x);
+    if(writeindex<kGuard || first<n)
+      std::copy(x,x+kGuard,x+historysize);
+  }
+  writeindex = (writeindex+n) & (historysize-1);
+  if(tail.left>0)
+    tail.captured += n;
+}
+
+template<class T>
+void LivePlayer<T>::MixTail(T *const *out, long offset, long n)
+{
+  n = std::min(n,tail.left);
+  if(n<=0)
+    return;
+  
+  // the tail can only read what is captured already, it stops where it can't
+  const long mask = historysize-1;
+  if(tail.ratio == 1.0)
+  {
+    n = std::min(n,tail.captured-tail.pos);
+  }
+  else
+  {
+    long limit = long(std::ceil(double(tail.captured-1)/tail.ratio));
+    while(limit>0 && long(double(limit-1)*tail.ratio)+1>=tail.captured)
+      limit--;
+    n = std::min(n,limit-tail.pos);
+  }
+  if(n<=0)
+  {
+    tail.left = 0;
+    return;
+  }
+  
+  const float *env = envelope.Tail()+tail.done;
+  if(tail.ratio == 1.0)
+  {
+    const long start = (tail.start+tail.pos) & mask;
+    const long first = std::min(n,historysize-start);
+    for(long c=0;c<numchannels;c++)
+    {
+      const T *x = Channel(c);
+      const T *y = Channel(partner[c]);
+      PanMatrix::MixAdd(x+start,y+start,env,tail.selfgain[c],tail.crossgain[c],out[c]+offset,first);
+      PanMatrix::MixAdd(x,y,env+first,tail.selfgain[c],tail.crossgain[c],out[c]+offset+first,n-first);
+    }
+  }
+  else
+  {
+    // a fading tail is read with linear interpolation, whatever the quality
+    for(long done=0;done<n;done+=kChunk)
+    {
+      const long m = std::min(long(kChunk),n-done);
+      for(long i=0;i<m;++i)
+      {
+        const double p = double(tail.pos+done+i)*tail.ratio;
+        const long pos = long(p);
+        const T frac = T(p-double(pos));
+        const long index = (tail.start+pos) & mask;
+        for(long c=0;c<numchannels;c++)
+        {
+          const T *x = Channel(c)+index;
+          chunk[c*kChunk+i] = x[0] + frac*(x[1]-x[0]);
+        }
+      }
+      for(long c=0;c<numchannels;c++)
+        PanMatrix::MixAdd(&chunk[c*kChunk],&chunk[partner[c]*kChunk],env+done,
+                          tail.selfgain[c],tail.crossgain[c],out[c]+offset+done,m);
+    }
+  }
+  tail.pos += n;
+  tail.done += n;
+  tail.left -= n;
+}
+
+template<class T>
+long LivePlayer<T>::process(const T *const *in, T *const *out, long offset, long numSamples)
+{
+  // the cut switch is deferred to the next call, so that the samples
+  // of the previous span are still processed with its effect settings
+  while(currentcut<cuts.size() && readindex>=cuts[currentcut].size)
+    NextCut();
+  
+  if(currentcut>=cuts.size())
+  {
+    Write(in,offset,numSamples);
+    for(long c=0;c<numchannels;c++)
+      std::fill(out[c]+offset,out[c]+offset+numSamples,T(0));
+    MixTail(out,offset,numSamples);
+    return numSamples;
+  }
+  
+  const CutInfo &cut = cuts[currentcut];
+  const long span = std::min(numSamples,cut.size-readindex);
+  
+  //store input first, the host may process in place
+  Write(in,offset,span);
+  inputindex = std::min(inputindex+span,historysize);
+  
+  //dutycycle on, the cut can only read what is captured already
+  const long captured = inputindex-cutoffset;
+  long on = std::max(0L,std::min(span,std::min(cut.length,capturelength-cutoffset)-readindex));
+  on = std::min(on,std::max(0L,captured-readindex));
+  // a lookback moves the capture end back, not the end of the envelope
+  on = std::min(on,std::max(0L,capacity-readindex));
+  if(ratio != 1.0)
+  {
+    // fractional read pointer, the samples right of it must be captured already.
+    // a detuned cut going past the captured material plays silence.
+    const long reach = resampler.Reach();
+    long limit = long(std::ceil(double(captured-reach)/ratio));
+    while(limit>0 && long(double(limit-1)*ratio)+reach>=captured)
+      limit--;
+    on = std::max(0L,std::min(on,limit-readindex));
+  }
+  if(on>0)
+  {
+    const long mask = historysize-1;
+    const float *env = envelope.Get(readindex,on);
+    if(ratio == 1.0)
+    {
+      // in one or two runs, split at the wrap of the ring
+      const long start = (cutstart+readindex) & mask;
+      const long first = std::min(on,historysize-start);
+      for(long c=0;c<numchannels;c++)
+      {
+        const T *x = Channel(c);
+        const T *y = Channel(partner[c]);
+        PanMatrix::Mix(x+start,y+start,env,selfgain[c],crossgain[c],out[c]+offset,first);
+        PanMatrix::Mix(x,y,env+first,selfgain[c],crossgain[c],out[c]+offset+first,on-first);
+      }
+    }
+    else
+    {
+      const long taps = resampler.Taps();
+      const long first = 1-resampler.Reach();
+      const bool linear = resampler.IsLinear();
+      for(long done=0;done<on;done+=kChunk)
+      {
+        const long n = std::min(long(kChunk),on-done);
+        for(long i=0;i<n;++i)
+        {
+          const double p = double(readindex+done+i)*ratio;
+          const long pos = long(p);
+          if(linear)
+          {
+            const T frac = T(p-double(pos));
+            const long index = (cutstart+pos) & mask;
+            for(long c=0;c<numchannels;c++)
+            {
+              const T *x = Channel(c)+index;
+              chunk[c*kChunk+i] = x[0] + frac*(x[1]-x[0]);
+            }
+          }
+          else
+          {
+            // the coefficients are shared by all channels
+            const float *coefs = resampler.Coefficients(p-double(pos));
+            const long index = (cutstart+pos+first) & mask;
+            for(long c=0;c<numchannels;c++)
+              chunk[c*kChunk+i] = Resampler::Dot(coefs,Channel(c)+index,taps);
+          }
+        }
+        for(long c=0;c<numchannels;c++)
+          PanMatrix::Mix(&chunk[c*kChunk],&chunk[partner[c]*kChunk],env+done,
+                         selfgain[c],crossgain[c],out[c]+offset+done,n);
+      }
+    }
+  }
+  //dutycycle off
+  for(long c=0;c<numchannels;c++)
+    std::fill(out[c]+offset+on,out[c]+offset+span,T(0));
+  
+  //crossfade, the cut hands over to the tail at the end of its duty cycle
+  if(envelope.Overlap())
+  {
+    const long end = cut.length-readindex;
+    if(end>0 && end<=span)
+    {
+      MixTail(out,offset,end);
+      StartTail(cut.length);
+      MixTail(out,offset+end,span-end);
+    }
+    else
+      MixTail(out,offset,span);
+  }
+  
+  readindex += span;
+  return span;
+}
+
+template<class T>
+long LivePlayer<T>::Skip(const T *const *in, long offset, long numSamples)
+{
+  while(currentcut<cuts.size() && readindex>=cuts[currentcut].size)
+    NextCut();
+  // whatever the tail would read is silent
+  tail.left = 0;
+  
+  if(currentcut>=cuts.size())
+  {
+    Write(in,offset,numSamples);
+    return numSamples;
   }
+  
+  const long span = std::min(numSamples,cuts[currentcut].size-readindex);
+  Write(in,offset,span);
+  inputindex = std::min(inputindex+span,historysize);
+  readindex += span;
+  return span;
 }
 
+template class LivePlayer<float>;
+template class LivePlayer<double>;
+
 //------------------------------------------------------------------------------------------------
 #include <algorithm>
-#include <functional>
+#include <chrono>
 #include <cassert>
-using std::for_each;
-using std::mem_fun;
-using std::bind2nd;
 
-BBCutter::BBCutter(LivePlayer &player)
+CutSettings::CutSettings()
+: strategy(kCutProc11)
+, subdiv(8)
+, unitsperbar(8)
+, spu(0.0)
+, seed(1)
+, stutterchance(1.f)
+, stutterarea(0.5f)
+, minrepeats(0)
+, maxrepeats(1)
+, straightchance(0.5f)
+, regularchance(0.7f)
+, ritardchance(0.6f)
+, accel(0.9f)
+, activity(0.1f)
+{
+}
+
+// everything a phrase depends on besides its position
+static uint64_t HashSettings(const CutSettings &s)
+{
+  PlanHash h;
+  h.Add(double(s.minamp)).Add(double(s.maxamp)).Add(double(s.minpan)).Add(double(s.maxpan));
+  h.Add(double(s.mindetune)).Add(double(s.maxdetune));
+  h.Add(double(s.dutycycle)).Add(double(s.filldutycycle));
+  h.Add(s.minphraselength).Add(s.maxphraselength).Add(s.maxcutlength);
+  h.Add(s.strategy).Add(s.subdiv).Add(s.unitsperbar).Add(s.spu).Add(long(s.seed));
+  h.Add(double(s.stutterchance)).Add(double(s.stutterarea)).Add(s.minrepeats).Add(s.maxrepeats);
+  h.Add(double(s.straightchance)).Add(double(s.regularchance));
+  h.Add(double(s.ritardchance)).Add(double(s.accel));
+  h.Add(double(s.activity));
+  return h.Value();
+}
+
+CutPlanner::CutPlanner()
+: pendingpattern(NULL)
+, unloadpattern(false)
+, retired{}
+, patterns(0)
+, settingshash(HashSettings(settings))
+, plannedbar(0)
+, nextbar(0)
+, plannedunits(0)
+, plannedtotal(0)
+, unitsinblock(0)
+, replay(NULL)
+, replayblock(0)
+, recordphrase(false)
+, restarts(0)
+, restartbar(0)
+, restarted(0)
+, running(false)
+, background(false)
+{
+  cutproc11.SetParams(&settings);
+  warpcutproc.SetParams(&settings);
+  sqpusher.SetParams(&settings);
+  patternproc.SetParams(&settings);
+  cutproc11.SetRandom(&random);
+  warpcutproc.SetRandom(&random);
+  sqpusher.SetRandom(&random);
+  patternproc.SetRandom(&random);
+  
+  plans.Resize(kPlanAhead);
+  updates.Resize(kSettingsSlots);
+}
+
+CutPlanner::~CutPlanner()
+{
+  SetBackground(false);
+  delete pendingpattern.exchange(NULL);
+  FreeRetired();
+}
+
+void CutPlanner::Prepare(long maxcuts)
+{
+  const bool wasbackground = background;
+  SetBackground(false);
+  Update();
+  FreeRetired();
+  for(long i=0;i<long(plans.Slots().size());i++)
+    plans.Slots()[i].cuts.reserve(maxcuts);
+  plans.Clear();
+  plannedbar = nextbar = plannedunits = plannedtotal = unitsinblock = 0;
+  Forget();
+  cache.Clear();
+  SetBackground(wasbackground);
+}
+
+void CutPlanner::SetCacheBudget(size_t bytes)
+{
+  const bool wasbackground = background;
+  SetBackground(false);
+  Forget();
+  cache.SetBudget(bytes);
+  SetBackground(wasbackground);
+}
+
+void CutPlanner::SetBackground(bool v)
+{
+  if(v == background)
+    return;
+  background = v;
+  if(v)
+  {
+    running.store(true);
+    worker = std::thread(&CutPlanner::Run,this);
+  }
+  else
+  {
+    running.store(false);
+    worker.join();
+  }
+}
+
+bool CutPlanner::Publish(const CutSettings &s)
+{
+  CutSettings *slot = updates.Back();
+  if(!slot)
+    return false;
+  *slot = s;
+  updates.Push();
+  return true;
+}
+
+void CutPlanner::SetPattern(std::unique_ptr<CutPattern> p)
+{
+  FreeRetired();
+  // a pattern posted before and not taken over yet is never used
+  unloadpattern.store(!p);
+  delete pendingpattern.exchange(p.release());
+}
+
+void CutPlanner::FreeRetired()
+{
+  for(long i=0;i<kRetiredSlots;i++)
+    delete retired[i].exchange(NULL);
+}
+
+void CutPlanner::Restart(long bar)
+{
+  restartbar.store(bar,std::memory_order_relaxed);
+  restarts.fetch_add(1,std::memory_order_release);
+}
+
+BlockPlan *CutPlanner::Front()
+{
+  BlockPlan *plan = plans.Front();
+  const long r = restarts.load(std::memory_order_relaxed);
+  while(plan && plan->restart != r)
+  {
+    plans.Pop();
+    plan = plans.Front();
+  }
+  if(!plan && !background && PlanNext())
+    plan = plans.Front();
+  return plan;
+}
+
+void CutPlanner::Pop()
+{
+  plans.Pop();
+}
+
+// a switch over the concrete procedures, like std::visit without a variant,
+// so each call is bound at compile time while every proc keeps its state
+template<class F>
+inline auto CutPlanner::WithStrategy(F f)
+{
+  switch(settings.strategy)
+  {
+    case kWarpCut: return f(warpcutproc);
+    case kSQPusher: return f(sqpusher);
+    case kPattern:
+      if(patternproc.Loaded())
+        return f(patternproc);
+      return f(cutproc11);
+    default: return f(cutproc11);
+  }
+}
+
+void CutPlanner::Run()
+{
+  while(running.load(std::memory_order_acquire))
+  {
+    while(running.load(std::memory_order_relaxed) && PlanNext())
+      ;
+    FreeRetired();
+    // a block lasts a unit at least, polling every millisecond keeps up
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+bool CutPlanner::PlanNext()
+{
+  Update();
+  BlockPlan *plan = plans.Back();
+  if(!plan)
+    return false;
+  Plan(*plan);
+  plans.Push();
+  return true;
+}
+
+void CutPlanner::Plan(BlockPlan &plan)
+{
+  const long r = restarts.load(std::memory_order_acquire);
+  const bool restarting = r != restarted;
+  if(restarting)
+  {
+    restarted = r;
+    plannedunits = plannedtotal;
+    nextbar = restartbar.load(std::memory_order_relaxed);
+  }
+  
+  plan.phrase = plannedunits >= plannedtotal;
+  if(plan.phrase)
+  {
+    long start, bars;
+    PhraseAt(nextbar,start,bars,plannedtotal);
+    // a restart plans the phrase from its start. otherwise the phrase before was
+    // drawn with other settings and ended inside this one, the rest of it follows
+    if(!restarting && start < nextbar)
+    {
+      bars -= nextbar-start;
+      start = nextbar;
+      plannedtotal = std::min(plannedtotal,bars*std::max(settings.unitsperbar,1L));
+    }
+    plannedbar = start;
+    plannedunits = 0;
+    nextbar = plannedbar + bars;
+    StartPhrase();
+  }
+  random.SetPosition(plannedbar,plannedunits);
+  
+  if(replay && replayblock < replay->blocks)
+  {
+    const PlanCache<CutInfo>::Block &block = cache.BlockOf(*replay,replayblock++);
+    plan.cuts.resize(block.count);
+    cache.CopyCuts(block,plan.cuts.begin());
+    unitsinblock = block.units;
+  }
+  else
+  {
+    WithStrategy([&](auto &proc) {
+      proc.ChooseCuts(plan.cuts,unitsinblock,
+                      plannedunits,plannedtotal,settings.subdiv,settings.spu);
+    });
+    if(recordphrase)
+      recordphrase = cache.Append(unitsinblock,plan.cuts.begin(),plan.cuts.size());
+  }
+  plan.bar = plannedbar;
+  plan.restart = restarted;
+  plan.totalunits = plannedtotal;
+  plan.units = unitsinblock;
+  // an empty block still takes the unit it starts on
+  plannedunits += std::max(unitsinblock,1L);
+  
+  if(recordphrase && plannedunits >= plannedtotal)
+  {
+    cache.End();
+    recordphrase = false;
+  }
+}
+
+// the phrase a bar falls into. phrases tile cells as long as the longest phrase, each
+// one split from its start by lengths drawn on the bars the phrases start on, so
+// where a phrase starts does not depend on where playing started
+void CutPlanner::PhraseAt(long bar, long &start, long &bars, long &units)
+{
+  // the next phrase waits for the start of a bar
+  const long unitsperbar = std::max(settings.unitsperbar,1L);
+  auto BarsOf = [unitsperbar](long u) { return std::max((u+unitsperbar-1)/unitsperbar,1L); };
+  const long cell = BarsOf(WithStrategy([](auto &proc) { return proc.MaxPhraseLength(); })*settings.subdiv);
+  const long end = bar - (bar%cell+cell)%cell + cell;
+  start = end-cell;
+  for(;;)
+  {
+    // the unit -1 keeps these draws apart from the ones of the blocks
+    random.SetPosition(start,-1);
+    units = WithStrategy([](auto &proc) { return proc.ChoosePhraseLength(); })*settings.subdiv;
+    bars = std::min(BarsOf(units),end-start);
+    units = std::min(units,bars*unitsperbar);
+    if(bar < start+bars)
+      return;
+    start += bars;
+  }
+}
+
+void CutPlanner::StartPhrase()
+{
+  Forget();
+  if(!cache.Enabled())
+    return;
+  phrasekey.settings = PlanHash().Add(settingshash).Add(patterns).Value();
+  phrasekey.bar = plannedbar;
+  replay = cache.Find(phrasekey);
+  if(replay && replay->totalunits != plannedtotal)
+    replay = NULL;
+  if(replay)
+    return;
+  cache.Begin(phrasekey,plannedtotal);
+  recordphrase = true;
+}
+
+// the phrase underway changed, it is neither replayed nor recorded any further
+void CutPlanner::Forget()
+{
+  replay = NULL;
+  replayblock = 0;
+  recordphrase = false;
+}
+
+void CutPlanner::Update()
+{
+  // the pattern replaced goes to a free retired slot, planning on demand runs on the
+  // audio thread. a new pattern waits while no slot is free
+  for(long i=0;i<kRetiredSlots;i++)
+  {
+    if(retired[i].load(std::memory_order_acquire))
+      continue;
+    CutPattern *p = pendingpattern.exchange(NULL);
+    if(p || unloadpattern.exchange(false))
+    {
+      patternproc.SetPattern(p);
+      retired[i].store(pattern.release(),std::memory_order_release);
+      pattern.reset(p);
+      patterns++;
+      Forget();
+    }
+    break;
+  }
+  
+  bool updated = false;
+  CutSettings latest;
+  while(const CutSettings *s = updates.Front())
+  {
+    latest = *s;
+    updates.Pop();
+    updated = true;
+  }
+  if(updated)
+    Apply(latest);
+}
+
+void CutPlanner::Apply(const CutSettings &s)
+{
+  random.Seed(s.seed);
+  cutproc11.SetStutterChance(s.stutterchance);
+  cutproc11.SetStutterArea(s.stutterarea);
+  cutproc11.SetMinRepeats(s.minrepeats);
+  cutproc11.SetMaxRepeats(s.maxrepeats);
+  warpcutproc.SetStraightChance(s.straightchance);
+  warpcutproc.SetRegularChance(s.regularchance);
+  warpcutproc.SetRitardChance(s.ritardchance);
+  warpcutproc.SetAccel(s.accel);
+  sqpusher.SetActivity(s.activity);
+  settings = s;
+  const uint64_t hash = HashSettings(s);
+  if(hash != settingshash)
+    Forget();
+  settingshash = hash;
+}
+
+//------------------------------------------------------------------------------------------------
+BBCutter::BBCutter(LivePlayerBase &player)
 : player(player)
 , tempo(180)
 , sr(44100)
@@ -591,19 +1485,18 @@ BBCutter::BBCutter(LivePlayer &player)
 //states
 , unitsdone(0)
 , totalunits(0)
-, barsnow(0)
 , unitsinblock(0)
 , unitsinsideblock(0)
 , barsinsample(1)
 , slicestart(0)
-, strategy(&cutproc11)
+, cutproc(kCutProc11)
+, usepattern(false)
+, lookbackunits(0)
+, changed(true)
+, source(&planner)
 {
-  procs.reserve(kNumCutProcs);
-  procs.push_back(&cutproc11);
-  procs.push_back(&warpcutproc);
-  procs.push_back(&sqpusher);
-  
   player.SetListenerManager(&listenermanager);
+  UpdateRates();
 }
 
  BBCutter::~BBCutter()
@@ -617,36 +1510,61 @@ void BBCutter::RegisterListener(BBCutListener *l)
 
 void	BBCutter::SetCutProc(long i)
 {
-  assert(i>=0 && i<procs.size());
-  if(i>=0 && i<procs.size())
+  assert(i>=0 && i<kPattern);
+  if(i>=0 && i<kPattern)
   {
-    strategy = procs[i];
+    cutproc = i;
+    settings.strategy = usepattern? long(kPattern) : cutproc;
+    changed = true;
   }
 }
 
+void	BBCutter::SetUsePattern(bool v)
+{
+  usepattern = v;
+  settings.strategy = usepattern? long(kPattern) : cutproc;
+  changed = true;
+}
+
+void	BBCutter::SetCutPattern(std::unique_ptr<CutPattern> p)
+{
+  lookbackunits.store(p? p->MaxLookback() : 0,std::memory_order_relaxed);
+  seeker.SetPattern(std::unique_ptr<CutPattern>(p? new CutPattern(*p) : NULL));
+  planner.SetPattern(std::move(p));
+}
+
+long	BBCutter::LookbackSamples() const
+{
+  if(!usepattern)
+    return 0;
+  const double spu = sr*60.0/tempo*beatsPerBar/double(subdiv);
+  return long(std::ceil(double(lookbackunits.load(std::memory_order_relaxed))*spu));
+}
+
 void	BBCutter::SetBarsInSample(long bars) { barsinsample = bars; UpdateRates(); }
 void	BBCutter::SetTempo(double v) { tempo=v; UpdateRates(); }
 void	BBCutter::SetSubdiv(long v) { subdiv = v; UpdateRates(); }
-void	BBCutter::SetStutterChance(float chance)  { cutproc11.SetStutterChance(chance);}
-void	BBCutter::SetStutterArea(float area)      { cutproc11.SetStutterArea(area);}
-void	BBCutter::SetMaxRepeats(long repeats)     { cutproc11.SetMaxRepeats(repeats);}
-void	BBCutter::SetMinRepeats(long repeats)     { cutproc11.SetMinRepeats(repeats);}
-void	BBCutter::SetStraightChance(float chance) { warpcutproc.SetStraightChance(chance);}
-void	BBCutter::SetRegularChance(float chance)  { warpcutproc.SetRegularChance(chance);}
-void	BBCutter::SetRitardChance(float chance)   { warpcutproc.SetRitardChance(chance);}
-void	BBCutter::SetAccel(float v)               { warpcutproc.SetAccel(v);}
-void	BBCutter::SetActivity(float v)            { sqpusher.SetActivity(v);}
+void	BBCutter::SetStutterChance(float chance)  { settings.stutterchance = chance; changed = true;}
+void	BBCutter::SetStutterArea(float area)      { settings.stutterarea = area; changed = true;}
+void	BBCutter::SetMaxRepeats(long repeats)     { settings.maxrepeats = repeats; changed = true;}
+void	BBCutter::SetMinRepeats(long repeats)     { settings.minrepeats = repeats; changed = true;}
+void	BBCutter::SetStraightChance(float chance) { settings.straightchance = chance; changed = true;}
+void	BBCutter::SetRegularChance(float chance)  { settings.regularchance = chance; changed = true;}
+void	BBCutter::SetRitardChance(float chance)   { settings.ritardchance = chance; changed = true;}
+void	BBCutter::SetAccel(float v)               { settings.accel = v; changed = true;}
+void	BBCutter::SetActivity(float v)            { settings.activity = v; changed = true;}
 void	BBCutter::SetFade(float v)                { player.SetFade( ms2samples(v,sr) );}
-void	BBCutter::SetMinPhraseLength(long v) { for_each(procs.begin(),procs.end(),bind2nd(mem_fun(&CutProc::SetMinPhraseLength),v));}
-void	BBCutter::SetMaxPhraseLength(long v) { for_each(procs.begin(),procs.end(),bind2nd(mem_fun(&CutProc::SetMaxPhraseLength),v));}
-void	BBCutter::SetMinAmp(float v)      { for_each(procs.begin(),procs.end(),bind2nd(mem_fun(&CutProc::SetMinAmp),v));}
-void	BBCutter::SetMaxAmp(float v)      { for_each(procs.begin(),procs.end(),bind2nd(mem_fun(&CutProc::SetMaxAmp),v));}
-void	BBCutter::SetMinPan(float v)      { for_each(procs.begin(),procs.end(),bind2nd(mem_fun(&CutProc::SetMinPan),v));}
-void	BBCutter::SetMaxPan(float v)      { for_each(procs.begin(),procs.end(),bind2nd(mem_fun(&CutProc::SetMaxPan),v));}
-void	BBCutter::SetDutyCycle(float v)   { for_each(procs.begin(),procs.end(),bind2nd(mem_fun(&CutProc::SetDutyCycle),v));}
-void	BBCutter::SetFillDutyCycle(float v) { for_each(procs.begin(),procs.end(),bind2nd(mem_fun(&CutProc::SetFillDutyCycle),v));}
-void	BBCutter::SetMinDetune(float v)   { for_each(procs.begin(),procs.end(),bind2nd(mem_fun(&CutProc::SetMinDetune),v));}
-void	BBCutter::SetMaxDetune(float v)   { for_each(procs.begin(),procs.end(),bind2nd(mem_fun(&CutProc::SetMaxDetune),v));}
+void	BBCutter::SetMinPhraseLength(long v) { settings.minphraselength = v; changed = true;}
+void	BBCutter::SetMaxPhraseLength(long v) { settings.maxphraselength = v; changed = true;}
+void	BBCutter::SetSeed(uint32_t v)     { settings.seed = v; changed = true;}
+void	BBCutter::SetMinAmp(float v)      { settings.minamp = v; changed = true;}
+void	BBCutter::SetMaxAmp(float v)      { settings.maxamp = v; changed = true;}
+void	BBCutter::SetMinPan(float v)      { settings.minpan = v; changed = true;}
+void	BBCutter::SetMaxPan(float v)      { settings.maxpan = v; changed = true;}
+void	BBCutter::SetDutyCycle(float v)   { settings.dutycycle = v; changed = true;}
+void	BBCutter::SetFillDutyCycle(float v) { settings.filldutycycle = v; changed = true;}
+void	BBCutter::SetMinDetune(float v)   { settings.mindetune = v; changed = true;}
+void	BBCutter::SetMaxDetune(float v)   { settings.maxdetune = v; changed = true;}
 void	BBCutter::SetNumerator(double v)  { numerator   = v; beatsPerBar=4.0*numerator/denominator; UpdateRates();}
 void	BBCutter::SetDenominator(double v) { denominator = v; beatsPerBar=4.0*numerator/denominator; UpdateRates();}
 
@@ -656,65 +1574,151 @@ void	BBCutter::SetSampleRate(double v)
   UpdateRates();
 }
 
+void	BBCutter::Prepare(double samplerate, double mintempo, double maxbeatsperbar, long maxsubdiv)
+{
+  // the largest stutter multiplier of CutProc11 over a whole bar,
+  // or the most repeats WarpCutProc can choose
+  const long maxcuts = std::max(8*maxsubdiv,32L);
+  // no cut procedure produces cuts longer than a bar
+  const long maxcutlength = long(std::ceil(SamplesPerBeat(samplerate,mintempo)*maxbeatsperbar));
+  planner.Prepare(maxcuts);
+  seeker.Prepare(maxcuts);
+  source = &planner;
+  player.Prepare(maxcuts,maxcutlength);
+  settings.maxcutlength = maxcutlength;
+  changed = true;
+}
+
+void	BBCutter::SetPlanCacheBudget(size_t bytes)
+{
+  planner.SetCacheBudget(bytes);
+}
+
+void	BBCutter::SetBackgroundPlanning(bool v)
+{
+  // the worker starts planning right away, with the current settings
+  Publish();
+  planner.SetBackground(v);
+}
+
 void	BBCutter::SetTimeInfos(double bpm,double num,double den,double srate)
 {
-  bool changed = false;
+  bool ratechanged = false;
   if(tempo != bpm)
   {
     tempo = bpm;
-    changed = true;
+    ratechanged = true;
   }
   if(numerator != num)
   {
     numerator = num;
-    changed = true;
+    ratechanged = true;
   }
   if(denominator != den)
   {
     denominator = den;
-    changed = true;
+    ratechanged = true;
   }
   if(srate != sr)
   {
     sr = srate;
-    changed = true;
+    ratechanged = true;
   }
-  if(changed)
+  if(ratechanged)
     UpdateRates();
 }
 
 void	BBCutter::UpdateRates()
 {
+  settings.subdiv = subdiv;
+  settings.unitsperbar = long(UnitsPerBar(subdiv,numerator,denominator));
+  settings.spu = SamplesPerUnit();
+  changed = true;
 }
 
 void	BBCutter::Phrase(long bar, long sd)
 {
-  barsnow = strategy->ChoosePhraseLength();
-  totalunits = barsnow*subdiv;
-  unitsdone = 0;
-  
+  source = &planner;
+  BlockPlan *plan = planner.Front();
+  if(!plan || !plan->phrase || bar < plan->bar || bar >= plan->bar+PhraseBars(*plan))
+  {
+    // the position jumped or the planner fell behind, what is queued is out of place
+    Seek(bar,sd);
+    return;
+  }
+  Enter(*plan,bar,sd,0.0);
+}
+
+void	BBCutter::Enter(BlockPlan &plan, long bar, long sd, double phase)
+{
+  const long unitsperbar = std::max(long(UnitsPerBar(subdiv,numerator,denominator)),1L);
+  const long target = (bar-plan.bar)*unitsperbar+sd;
+  totalunits = plan.totalunits;
+  plan.phrase = false; // now its cuts are the first block
   listenermanager.OnPhrase(bar,sd);
+  
+  // skip the blocks done before the unit
+  long start = 0;
+  BlockPlan *block = &plan;
+  while(block && !block->phrase && start+std::max(block->units,1L) <= target)
+  {
+    start += std::max(block->units,1L);
+    source->Pop();
+    block = source->Front();
+  }
+  
+  unitsdone = target;
+  Block(bar,sd);
+  // the block the unit falls into resumes at its read offset
+  if(block && !block->phrase)
+  {
+    unitsinsideblock = target-start;
+    player.Resume(long((double(unitsinsideblock)+phase)*SamplesPerUnit()));
+  }
+  
+  unitsinsideblock++;
+  unitsdone++;
+  listenermanager.OnUnit(bar,sd);
+}
+
+long	BBCutter::PhraseBars(const BlockPlan &plan)
+{
+  const long unitsperbar = std::max(long(UnitsPerBar(subdiv,numerator,denominator)),1L);
+  return std::max((plan.totalunits+unitsperbar-1)/unitsperbar,1L);
 }
 
 void	BBCutter::Block(long bar,long sd)
 {
   unitsinsideblock=0;
-  std::vector<CutInfo> cuts;
-  strategy->ChooseCuts(cuts,unitsinblock,
-                       unitsdone,totalunits,subdiv,SamplesPerUnit());
-  player.OnBlock(cuts);
+  BlockPlan *plan = source->Front();
+  if(plan && !plan->phrase)
+  {
+    std::swap(player.NextCuts(),plan->cuts);
+    unitsinblock = plan->units;
+    source->Pop();
+  }
+  else
+  {
+    // nothing planned for this phrase, pass the unit through
+    CutList &cuts = player.NextCuts();
+    cuts.resize(1);
+    cuts[0].size = cuts[0].length = long(SamplesPerUnit());
+    unitsinblock = 1;
+  }
+  player.OnBlock();
   
   listenermanager.OnBlock(bar,sd);
 }
 
 void	BBCutter::Unit(long bar, long sd)
 {
+  Publish();
+  
   if( totalunits<=0 || unitsdone>=totalunits || unitsdone<0 ) //out of phrase bounds and start of a bar
   {
     if(sd == 0)
       Phrase(bar,sd);
-    else
-      return;
+    return;
   }
   
   if( unitsinsideblock>=unitsinblock || unitsinsideblock<0) //out of block bounds
@@ -726,6 +1730,33 @@ void	BBCutter::Unit(long bar, long sd)
   listenermanager.OnUnit(bar,sd);
 }
 
+void	BBCutter::Seek(long bar, long sd, double phase)
+{
+  Publish();
+  
+  // the phrase the unit falls into is planned here and now. in the background
+  // the seeker plans the rest of it while the worker goes on from the next one
+  source = planner.Background()? &seeker : &planner;
+  if(source == &seeker)
+    seeker.Publish(settings);
+  source->Restart(bar);
+  BlockPlan *plan = source->Front();
+  assert(plan); // planned on demand
+  if(source == &seeker)
+    planner.Restart(plan->bar+PhraseBars(*plan));
+  Enter(*plan,bar,sd,phase);
+}
+
+void	BBCutter::Publish()
+{
+  if(!changed)
+    return;
+  changed = !planner.Publish(settings);
+  // the seeker takes what was published over as it plans
+  if(source == &seeker)
+    seeker.Publish(settings);
+}
+
 void	BBCutter::SetPosition(long bar, long sd)
 {
   const long delta = sd - (unitsdone % long(UnitsPerBar(subdiv,numerator,denominator)));
@@ -733,4 +1764,3 @@ void	BBCutter::SetPosition(long bar, long sd)
   unitsdone += delta;
   Unit(bar,sd);
 }
-
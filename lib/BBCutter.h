@@ -25,53 +25,46 @@
 #include <cstdlib>
 #include <algorithm>
 #include <numeric>
+#include <atomic>
+#include <thread>
+#include <memory>
+
+#include "AliasTable.h"
+#include "CutPattern.h"
+#include "Envelope.h"
+#include "PanMatrix.h"
+#include "PlanCache.h"
+#include "Random.h"
+#include "Resampler.h"
+#include "SPSCQueue.h"
 
 //-------------------------------------------------------------------------------
 struct Math
 {
-	static inline long  randominteger(long min, long max)
+  // R is Random or CounterRandom
+  template<class R>
+	static inline long  randominteger(R &random, long min, long max)
 	{
-    return long(0.5000001+randomfloat(min,max));
+    return long(0.5000001+randomfloat(random,min,max));
   }
 	
-	static inline double randomfloat(double min , double max)
+  template<class R>
+	static inline double randomfloat(R &random, double min , double max)
 	{
-    return min + (max-min)*double(rand())/double(RAND_MAX);
-  }
-  
-  static inline void randomseed(unsigned int seed)
-  {
-    srand(seed);
+    return min + (max-min)*random.Uniform();
   }
   
-  template<class T>
-  static inline T wchoose(T *values,double *weights,long size)
-  {
-    std::vector<double> cumsum(size);
-    cumsum[0] = *weights;
-    for(int i=1;i<cumsum.size();++i)
-      cumsum[i] = cumsum[i-1] + weights[i];
-    
-    double v = randomfloat(0.0,cumsum.back());
-    long index;
-    for(index=0;index<size;++index)
-      if(v<cumsum[index])
-        break;
-    return values[index];
-  }
-	
   static inline float clip(const float x,const float mn,const float mx)
   {
     return std::min(std::max(x,mn),mx);
   }
 };
 
-static const float pi_4 = atan(1.f);
-
 struct CutInfo
 {
 	long size;
 	long length; //<= size
+	long offset; // read start relative to the block start, <= 0 looks back into the history
 	float pan;
 	float amp;
 	float cents;
@@ -81,46 +74,85 @@ struct CutInfo
 	CutInfo();
 };
 
+/**
+ @brief fixed capacity list of cuts, filled in place by the cut procedures.
+ only reserve() allocates, it must not be called from the audio thread.
+ */
+class CutList
+{
+public:
+  CutList() : count(0) {}
+  
+  void reserve(long capacity)
+  {
+    storage.assign(capacity,CutInfo());
+    count = std::min(count,capacity);
+  }
+  
+  // resets the first n cuts, n is limited to the capacity
+  void resize(long n)
+  {
+    count = std::max(0L,std::min(n,capacity()));
+    std::fill(storage.begin(),storage.begin()+count,CutInfo());
+  }
+  
+  inline long size() const { return count; }
+  inline long capacity() const { return long(storage.size()); }
+  inline bool empty() const { return count==0; }
+  inline CutInfo &operator[](long i) { return storage[i]; }
+  inline const CutInfo &operator[](long i) const { return storage[i]; }
+  inline CutInfo *begin() { return storage.data(); }
+  inline CutInfo *end() { return storage.data()+count; }
+  
+private:
+  std::vector<CutInfo> storage;
+  long count;
+};
+
 enum CutId
 {
   kCutProc11=0,
   kWarpCut,
   kSQPusher,
+  kPattern,
   kAll,
   kNumCutProcs
 };
 
+// the parameters every cut procedure shares
+struct CutParams
+{
+  CutParams();
+  
+  float minamp, maxamp, minpan, maxpan, mindetune, maxdetune;
+  float dutycycle, filldutycycle;
+  long minphraselength, maxphraselength;
+  long maxcutlength; // samples the player holds of a cut, 0 for no limit
+};
+
 /**
- @brief base class for cut procedures
+ @brief base class for cut procedures.
+ the procedures are called directly by their concrete type, nothing is
+ virtual. a derived ChoosePhraseLength hides this one
  */
 class CutProc
 {
 public:
 	CutProc();
-  virtual ~CutProc();
-  
-	void SetMinAmp(float v);
-	void SetMaxAmp(float v);
-	void SetMinPan(float v);
-	void SetMaxPan(float v);
-	void SetMinDetune(float v);
-	void SetMaxDetune(float v);
-	void SetDutyCycle(float v);
-	void SetFillDutyCycle(float v);
-  void SetMinPhraseLength(long v);
-  void SetMaxPhraseLength(long v);
-  
-  virtual long ChoosePhraseLength();
-  virtual void ChooseCuts(std::vector<CutInfo> &cuts,
-                          long &unitsinblock,
-                          long unitsdone,
-                          long totalunits,
-                          long subdiv,
-                          double spu);
+  
+  // shared by all procedures of the owner, read when choosing
+  void SetParams(const CutParams *p);
+  // the generator of the owning planner, must be set before choosing.
+  // it is positioned at each block, draws only depend on the musical position
+  void SetRandom(CounterRandom *r);
+  
+  long ChoosePhraseLength();
+  // the longest phrase ChoosePhraseLength() returns
+  long MaxPhraseLength() const;
   
 protected:
-  float minamp,maxamp,minpan,maxpan,mindetune,maxdetune,dutycycle,filldutycycle;
-  long maxphraselength,minphraselength;
+  const CutParams *params;
+  CounterRandom *random;
 };
 
 //-------------------------------------------------------------------------------
@@ -134,7 +166,7 @@ public:
 	void SetMinRepeats(long v);
 	void SetMaxRepeats(long v);
   
-	void ChooseCuts(std::vector<CutInfo> &cuts,
+	void ChooseCuts(CutList &cuts,
                   long &unitsinblock,
                   long unitsdone,
                   long totalunits,
@@ -161,7 +193,7 @@ public:
 	void SetRitardChance(float chance);
 	void SetAccel(float v);
   
-	void ChooseCuts(std::vector<CutInfo> &cuts,
+	void ChooseCuts(CutList &cuts,
                   long &unitsinblock,
                   long unitsdone,
                   long totalunits,
@@ -184,7 +216,7 @@ public:
   
   
   long ChoosePhraseLength();
-	void ChooseCuts(std::vector<CutInfo> &cuts,
+	void ChooseCuts(CutList &cuts,
                   long &unitsinblock,
                   long unitsdone,
                   long totalunits,
@@ -192,14 +224,38 @@ public:
                   double spu);
 
 private:
-  void sqpusherinit();
-
-private:
-  typedef std::vector< std::vector< std::vector<double> > > CutSequence;
   double activity;
   bool fill;
-  long fillnumber,fillpos;
-  CutSequence cs;
+  long fillnumber,fillpos; // into the shared fill tables
+};
+
+//-------------------------------------------------------------------------------
+// evaluates a compiled CutPattern, see CutPattern.h
+class PatternCutProc : public CutProc
+{
+public:
+  PatternCutProc();
+  
+  // NULL unloads, the pattern has to outlive its use
+  void SetPattern(const CutPattern *p);
+  inline bool Loaded() const { return pattern != NULL; }
+  
+  long ChoosePhraseLength();
+  long MaxPhraseLength() const;
+	void ChooseCuts(CutList &cuts,
+                  long &unitsinblock,
+                  long unitsdone,
+                  long totalunits,
+                  long subdiv,
+                  double spu);
+  
+private:
+  long Choose(const CutPattern::Span &span, long fallback);
+  // patterns may ask for blocks longer than the player holds
+  void LimitCuts(CutList &cuts) const;
+  
+  const CutPattern *pattern;
+  long fill,fillpos; // fill is -1 outside of fills
 };
 
 //-------------------------------------------------------------------------------
@@ -232,122 +288,241 @@ public:
   void RegisterListener(BBCutListener *l);
 };
 
-static float trapeze(long i,long fade, long size)
-{
-  const long fadein  = (i<fade);
-  const long fadeout = (i>=(size-fade));
-  const float env = fadein                * (i)
-  + (1-fadein)*(1-fadeout)* (fade)
-  +  fadeout              * (fade-i);
-  return float(env)/float(fade);
-}
-
-static float expenv(float i,float fade,float size)
-{
-  return (1-exp(-5*i/fade)) * (1-exp(5*(i-size)/fade));
-}
-
-class LivePlayer
+// sample type independent part of the player: cut sequencing, envelope,
+// resampler setup and rotation, shared by all LivePlayer precisions
+class LivePlayerBase
 {
 public:
-	LivePlayer();
+	LivePlayerBase();
+	virtual ~LivePlayerBase() {}
 	void SetListenerManager(ListenerManager *lm);
   void SetFade(float v);
-  void OnBlock(std::vector<CutInfo> newcuts);
-
-  inline bool tick(float &outL, float &outR,const float inL,const float inR)
-  {
-    if(currentcut<cuts.size())
-    {
-      if(inputindex<inputbufferL.size()) //store input
-      {
-        inputbufferL[inputindex] = inL;
-        inputbufferR[inputindex] = inR;
-        inputindex++;
-      }
-      
-      if(readindex<cuts[currentcut].length) //dutycycle on
-      {
-        const float l = (*L)[readindex];
-        const float r = (*R)[readindex];
-        //rotation matrix
-        const float env = expenv(readindex,fade,cuts[currentcut].length);
-        
-        outL = env*(ll*l + rl*r);
-        outR = env*(lr*l + rr*r);
-        readindex++;
-      }
-      else                             //dutycycle off
-      {
-        readindex++;
-        outL = 0.f;
-        outR = 0.f;
-      }
-      
-      if(readindex>=cuts[currentcut].size) //end of cut
-      {
-        currentcut++;
-        readindex = 0;
-        if(currentcut>=cuts.size())
-        {
-          outL = 0.f;
-          outR = 0.f;
-          return false;
-        }
-				const float amp = cuts[currentcut].amp;
-				const float pan = cuts[currentcut].pan;
-        ll = amp * ((pan<0)? 1.f :  cos(pan*2*pi_4));
-        lr = amp * ((pan<0)? 0.f :  sin(pan*2*pi_4));
-        rl = amp * ((pan>0)? 0.f : -sin(pan*2*pi_4));
-        rr = amp * ((pan>0)? 1.f :  cos(pan*2*pi_4));
-        
-        if(fabs(cuts[currentcut].cents) > 1e-10)
-        {
-          //resample
-          const double ratio = pow(2.f,cuts[currentcut].cents/1200.f);
-          const long sz = std::min(   long(pitchedbufferL.size()),
-                                   (long(double(inputbufferL.size())/ratio)-1));
-          for(int i=0;i<sz;++i)
-          {
-            const long pos = long(float(i)*ratio);
-            const float frac = float(i)*ratio-float(pos);
-            const float a = inputbufferL[pos]*(1-frac)+inputbufferL[pos+1]*frac;
-            const float b = inputbufferR[pos]*(1-frac)+inputbufferR[pos+1]*frac;
-            pitchedbufferL[i] = a;
-            pitchedbufferR[i] = b;
-          }
-          L = &pitchedbufferL;
-          R = &pitchedbufferR;
-        }
-        // tell cut-synchrone effects
-        if(listenermanager)
-          listenermanager->OnCut(currentcut,cuts.size()); // allow interpolation...
-        
-        return true;
-      }
-    }
-    else
-    {
-      outL = 0.f;
-      outR = 0.f;
-    }
-    
-		return false;
-  }
+  void SetEnvelopeShape(long v);
+  void SetResamplerQuality(long v);
+  // overlap-add: the end of a cut fades out under the head of the next one
+  void SetCrossfade(bool v);
   
-private:
-	std::vector<float> inputbufferL;
-	std::vector<float> inputbufferR;
-	std::vector<float> pitchedbufferL;
-	std::vector<float> pitchedbufferR;
-	std::vector<float> *L;
-	std::vector<float> *R;
+  /**
+   @brief sets the channel count and how channels are paired for panning.
+   partners[c] is the mirrored channel of c, or c itself for unpaired channels,
+   the lower index of a pair is the left one. not real-time safe
+   */
+  void SetChannelPairs(const std::vector<long> &partners);
+  inline long NumChannels() const { return numchannels; }
+  
+  // allocates the cut arena and the capture buffers, not real-time safe
+  virtual void Prepare(long maxcuts, long maxcutlength);
+  
+  // the cut procedure fills these in place before OnBlock() hands them over
+  inline CutList &NextCuts() { return nextcuts; }
+  void OnBlock();
+  // continues the block just handed over as if it had started elapsed samples ago,
+  // reading what the history holds. the cut resumed fades in where it resumes
+  void Resume(long elapsed);
+  // samples the output may go on after the input fell silent, the longest block,
+  // as the cuts of a block read no further back than its start
+  inline long TailSamples() const { return capacity; }
+  // input samples back from the latest the current block and a fading tail can still
+  // read. once they are silent, all the player renders is silence
+  long LiveHistory() const;
+
+protected:
+  long numchannels;
+  std::vector<long> partner;
+  // the pan matrix as per channel gains of the channel and its partner
+  std::vector<float> selfgain;
+  std::vector<float> crossgain;
+  long capacity; // longest block that can be captured
+  long capturelength;
   long currentcut;
   long inputindex,readindex;
-  float ll,lr,rl,rr;
-  long fade;
-  std::vector<CutInfo> cuts;
+  // power of two ring of the input history, the last kHistoryBars bars at least
+  enum { kHistoryBars = 2 };
+  long historysize;
+  long writeindex; // ring position of the next input sample
+  long blockstart; // ring position of the first sample of the block
+  long cutstart; // ring position the current cut reads from
+  long cutoffset; // read start of the current cut relative to the block start
+  PanMatrix matrix;
+  float amp;
+  double ratio; // read speed of the current cut, from its detune
+  Envelope envelope;
+  Resampler resampler;
+  // the ring start is mirrored behind its end, so that the resampler
+  // taps and the interpolation can read past the wrap contiguously
+  enum { kGuard = Resampler::kMaxTaps };
+  // detuned cuts are resampled in chunks before the rotation
+  enum { kChunk = 64 };
+  CutList cuts;
+  CutList nextcuts;
 	ListenerManager *listenermanager;
+  
+  // second voice of the crossfade, the previous cut reading on past its end.
+  // a new tail replaces the one still fading, so there are never more than two voices
+  struct TailVoice
+  {
+    long start; // ring position its cut reads from
+    long pos; // read position in its cut
+    long done,left; // samples of the fade out played and to go
+    long captured; // samples written from start on
+    double ratio;
+    std::vector<float> selfgain;
+    std::vector<float> crossgain;
+  };
+  TailVoice tail;
+  
+  void NextCut();
+  void StartCut(const CutInfo &cut);
+  void StartTail(long pos);
+  void UpdateGains();
+};
+
+template<class T>
+class LivePlayer : public LivePlayerBase
+{
+public:
+  void SetChannelPairs(const std::vector<long> &partners);
+  void Prepare(long maxcuts, long maxcutlength) override;
+  
+  /**
+   @brief renders at most numSamples of every channel from offset on,
+   stopping at the end of the current cut so that cut-synchrone effects
+   can be updated in between.
+   inputs and outputs may point to the same buffers.
+   @return the number of samples processed
+   */
+  long process(const T *const *in, T *const *out, long offset, long numSamples);
+  /**
+   @brief as process() for input known to be silent once the output decayed:
+   the history and the cut sequence go on, nothing is read or rendered and
+   out is not written. stops at the end of the current cut as well.
+   @return the number of samples skipped
+   */
+  long Skip(const T *const *in, long offset, long numSamples);
+  
+private:
+  // planar history rings, one channel after the other
+	std::vector<T> history;
+  std::vector<T> chunk;
+  
+  void Allocate();
+  inline T *Channel(long c) { return history.data()+c*(historysize+kGuard); }
+  void Write(const T *const *in, long offset, long n);
+  void MixTail(T *const *out, long offset, long n);
+};
+
+//------------------------------------------------------------------------------------------------
+// everything the cut procedures choose from, handed to the planner as a whole
+struct CutSettings : CutParams
+{
+  CutSettings();
+  
+  long strategy;
+  long subdiv;
+  long unitsperbar;
+  double spu; // samples per unit
+  uint32_t seed;
+  float stutterchance, stutterarea;
+  long minrepeats, maxrepeats;
+  float straightchance, regularchance, ritardchance, accel;
+  float activity;
+};
+
+// one block as the cut procedure chose it
+struct BlockPlan
+{
+  bool phrase; // first block of a phrase
+  long bar; // the phrase starts on
+  long restart; // restarts the plan was made after
+  long totalunits; // units of its phrase
+  long units; // units the block lasts
+  CutList cuts;
+};
+
+/**
+ @brief runs the cut procedures ahead of the audio thread.
+ in the background, blocks are planned on a worker thread and handed over
+ through wait-free queues, settings one way and plans the other, so the audio
+ thread only swaps ready cut lists in. otherwise Front() plans on demand on the
+ calling thread, which keeps offline renders reproducible. planning neither
+ allocates nor frees, Prepare() and SetCacheBudget() set all memory up.
+ with a cache budget set, whole phrases are kept and replayed when the same
+ phrase comes up again, as in a looped region.
+ */
+class CutPlanner
+{
+public:
+  CutPlanner();
+  ~CutPlanner();
+  
+  // sizes the plans, not real-time safe
+  void Prepare(long maxcuts);
+  // memory for phrases planned before, 0 turns the cache off. not real-time safe
+  void SetCacheBudget(size_t bytes);
+  // starts or stops the worker thread, not real-time safe
+  void SetBackground(bool v);
+  inline bool Background() const { return background; }
+  // any thread but the audio thread, the planner takes it over before its next
+  // block, NULL unloads. the pattern replaced is freed by the worker or the next call
+  void SetPattern(std::unique_ptr<CutPattern> p);
+  
+  // audio thread side, wait-free
+  // false when the settings queue is full, publish again later
+  bool Publish(const CutSettings &s);
+  // the plans queued are out of place, plan the phrase the bar falls into,
+  // from its start on
+  void Restart(long bar);
+  // the next block or NULL when the worker fell behind.
+  // plans made before the last restart are dropped
+  BlockPlan *Front();
+  void Pop();
+  
+private:
+  // blocks planned ahead, settings reach the cuts that much later.
+  // between two SetPattern() calls at most two patterns are replaced
+  enum { kPlanAhead = 2, kSettingsSlots = 4, kRetiredSlots = 2 };
+  
+  template<class F> auto WithStrategy(F f);
+  void Run();
+  bool PlanNext();
+  void Plan(BlockPlan &plan);
+  void PhraseAt(long bar, long &start, long &bars, long &units);
+  void Update();
+  void Apply(const CutSettings &s);
+  void StartPhrase();
+  void Forget();
+  void FreeRetired();
+  
+  CutProc11 cutproc11;
+	WarpCutProc warpcutproc;
+	SQPusherCutProc sqpusher;
+  PatternCutProc patternproc;
+  std::unique_ptr<CutPattern> pattern;
+  std::atomic<CutPattern *> pendingpattern;
+  std::atomic<bool> unloadpattern; // posted instead of a pattern
+  // replaced patterns, not freed by the planner as it may run on the audio thread
+  std::atomic<CutPattern *> retired[kRetiredSlots];
+  long patterns; // taken over so far, part of the cache keys
+  CounterRandom random;
+  CutSettings settings; // as applied, the procs read the shared part
+  uint64_t settingshash;
+  long plannedbar, nextbar, plannedunits, plannedtotal, unitsinblock;
+  
+  // a phrase is either replayed from the cache or recorded into it
+  PlanCache<CutInfo> cache;
+  PlanKey phrasekey;
+  const PlanCache<CutInfo>::Phrase *replay;
+  long replayblock;
+  bool recordphrase;
+  
+  SPSCQueue<BlockPlan> plans;
+  SPSCQueue<CutSettings> updates;
+  std::atomic<long> restarts;
+  std::atomic<long> restartbar;
+  long restarted;
+  std::thread worker;
+  std::atomic<bool> running;
+  bool background;
 };
 
 //------------------------------------------------------------------------------------------------
@@ -359,11 +534,19 @@ inline float ms2samples(float t,float sr)
 class BBCutter
 {
 public:
-	BBCutter(LivePlayer &player);
+	BBCutter(LivePlayerBase &player);
   ~BBCutter();
   
 	void RegisterListener(BBCutListener *l);
 	void	SetCutProc(long i);
+	// the pattern procedure replaces the chosen one while a pattern is loaded
+	void	SetUsePattern(bool v);
+	// any thread, see CutPlanner::SetPattern
+	void	SetCutPattern(std::unique_ptr<CutPattern> p);
+	// samples before its block the loaded pattern may read from, 0 while it is not in use
+	long	LookbackSamples() const;
+	// see CutPlanner::SetCacheBudget
+	void	SetPlanCacheBudget(size_t bytes);
 	
   void	SetBarsInSample(long bars) ;
 	void	SetTempo(double v) ;
@@ -380,6 +563,7 @@ public:
   void	SetFade(float v);
   void	SetMinPhraseLength(long v);
 	void	SetMaxPhraseLength(long v);
+	void	SetSeed(uint32_t v);
 	void	SetMinAmp(float v);
 	void	SetMaxAmp(float v);
 	void	SetMinPan(float v);
@@ -392,6 +576,9 @@ public:
 	void	SetDenominator(double v);
 	
   void	SetSampleRate(double v);
+	void	Prepare(double samplerate, double mintempo, double maxbeatsperbar, long maxsubdiv);
+	// plans on a worker thread instead of on demand, not real-time safe
+	void	SetBackgroundPlanning(bool v);
 	void	SetTimeInfos(double bpm,double num,double den,double srate);
 	void	UpdateRates();
   
@@ -406,24 +593,40 @@ public:
   void	Block(long bar,long sd);
   void	Unit(long bar, long sd);
 	void	SetPosition(long bar, long sd);
+	/**
+	 @brief jumps to a position, phase is the part of the unit already gone.
+	 the phrase the bar falls into is planned from its start on the calling
+	 thread, in the background too. the blocks before the unit are skipped and
+	 the block the unit falls into resumes at its read offset
+	 */
+	void	Seek(long bar, long sd, double phase = 0.0);
   
 private:
+	// plays the phrase of plan from the unit on, plan is its first block
+	void	Enter(BlockPlan &plan, long bar, long sd, double phase);
+	long	PhraseBars(const BlockPlan &plan);
+	void	Publish();
+	
 	// params
 	double	tempo, sr;
 	long	subdiv;
 	double	numerator,denominator,beatsPerBar;
   
 	// states
-	long	unitsdone, totalunits, barsnow,
+	long	unitsdone, totalunits,
   unitsinblock, unitsinsideblock,	barsinsample,slicestart;
   
-	CutProc11 cutproc11;
-	WarpCutProc warpcutproc;
-	SQPusherCutProc sqpusher;
-	CutProc	*strategy;
-  std::vector<CutProc *> procs;
+  long cutproc;
+  bool usepattern;
+  std::atomic<long> lookbackunits; // of the last pattern set
+  CutSettings settings;
+  bool changed; // settings not published yet
+  CutPlanner planner;
+  // plans the phrase a seek lands in on demand, while the worker plans the next one
+  CutPlanner seeker;
+  CutPlanner *source; // of the blocks of the phrase underway
 	ListenerManager listenermanager;
-	LivePlayer	&player;
+	LivePlayerBase	&player;
 };
 
 #endif
@@ -19,7 +19,8 @@
 
 #include "BitCrusher.h"
 
-BitCrusher::BitCrusher()
+template<class T>
+BitCrusher<T>::BitCrusher()
 : minbits(32)
 , maxbits(32)
 , startbits(32)
@@ -33,22 +34,24 @@ BitCrusher::BitCrusher()
 , sr(44100)
 , lag(1.f)
 , count(0.f)
-, memory1(0.f)
-, memory2(0.f)
+, memory(2,T(0))
 , on(true)
+, random(NULL)
 {
 }
 
-void BitCrusher::OnBlock(long bar, long sd)
+template<class T>
+void BitCrusher<T>::OnBlock(long bar, long sd)
 {
-  startbits = Math::randomfloat(minbits,maxbits);
-  endbits = Math::randomfloat(minbits,maxbits);
+  startbits = Math::randomfloat(*random,minbits,maxbits);
+  endbits = Math::randomfloat(*random,minbits,maxbits);
   
-  startfreq = Math::randomfloat(minfreq,maxfreq);
-  endfreq = Math::randomfloat(minfreq,maxfreq);
+  startfreq = Math::randomfloat(*random,minfreq,maxfreq);
+  endfreq = Math::randomfloat(*random,minfreq,maxfreq);
 }
 
-void BitCrusher::OnCut(long cut, long numcuts)
+template<class T>
+void BitCrusher<T>::OnCut(long cut, long numcuts)
 {
   float bits = startbits + (float(cut)/float(numcuts))*endbits;
   multiplier = pow(2.f,bits);
@@ -59,12 +62,37 @@ void BitCrusher::OnCut(long cut, long numcuts)
 }
 
 // 0 - 32
-void BitCrusher::SetMinBits(float v){minbits = v;}
-void BitCrusher::SetMaxBits(float v){maxbits = v;}
+template<class T>
+void BitCrusher<T>::SetMinBits(float v){minbits = v;}
+template<class T>
+void BitCrusher<T>::SetMaxBits(float v){maxbits = v;}
 
-void BitCrusher::SetMinFreqFromNormalized(float v){minfreq = v*sr;}
-void BitCrusher::SetMaxFreqFromNormalized(float v){maxfreq = v*sr;}
-void BitCrusher::SetMinFreq(float v){minfreq = v;}
-void BitCrusher::SetMaxFreq(float v){maxfreq = v;}
-void BitCrusher::SetSampleRate(float v){sr = v;}
-void BitCrusher::SetOn(bool v){on = v;}
+template<class T>
+void BitCrusher<T>::SetMinFreqFromNormalized(float v){minfreq = v*sr;}
+template<class T>
+void BitCrusher<T>::SetMaxFreqFromNormalized(float v){maxfreq = v*sr;}
+template<class T>
+void BitCrusher<T>::SetMinFreq(float v){minfreq = v;}
+template<class T>
+void BitCrusher<T>::SetMaxFreq(float v){maxfreq = v;}
+template<class T>
+void BitCrusher<T>::SetSampleRate(float v){sr = v;}
+template<class T>
+void BitCrusher<T>::SetOn(bool v){on = v;}
+template<class T>
+void BitCrusher<T>::SetChannels(long v){memory.assign(v,T(0));}
+
+template<class T>
+long BitCrusher<T>::TailSamples() const
+{
+  if(!on)
+    return 0;
+  // the frequency of a cut never falls below the lower of the two bounds
+  const float lowest = std::max(std::min(minfreq,maxfreq),1.f);
+  return long(std::ceil(sr/lowest))+1;
+}
+template<class T>
+void BitCrusher<T>::SetRandom(Random *r){random = r;}
+
+template class BitCrusher<float>;
+template class BitCrusher<double>;
@@ -31,7 +31,9 @@
 */
 
 #include "BBCutter.h"
+#include <vector>
 
+template<class T>
 class BitCrusher : public BBCutListener
 {
 public:
@@ -48,28 +50,57 @@ public:
 	void SetMaxFreq(float v);
 	void SetSampleRate(float v);
 	void SetOn(bool v);
+	void SetRandom(Random *r);
   
-	inline void tick(float &out1,float &out2, const float in1, const float in2)
+	// not real-time safe
+	void SetChannels(long v);
+  
+	// samples a held value may outlast the input, the longest hold
+	long TailSamples() const;
+  
+	// in place on n samples of every channel from offset on
+	inline void process(T *const *io, long offset, long n)
 	{
-		if(on)
+		if(!on)
+			return;
+		// the sample and hold clock is shared, every channel replays it
+		const float start = count;
+		for(long c=0;c<long(memory.size());c++)
 		{
-			if(count>lag) 
+			T *x = io[c]+offset;
+			T held = memory[c];
+			count = start;
+			for(long i=0;i<n;i++)
 			{
-				// it also add jitter we should interpolate instead, 
-				// but eh it's a bitcrusher!
-				memory1 = floor(in1*multiplier)*divider;
-				memory2 = floor(in2*multiplier)*divider;
-				while(count>lag) 
+				if(count>lag) 
+				{
+					// it also add jitter we should interpolate instead, 
+					// but eh it's a bitcrusher!
+					held = floor(x[i]*multiplier)*divider;
+					while(count>lag) 
+						count -= lag;
+				}
+				count += 1.f;
+				x[i] = held;
+			}
+			memory[c] = held;
+		}
+	}
+	
+	// as process on n samples of silence: the clock goes on, the held values fall to 0
+	inline void Skip(long n)
+	{
+		if(!on)
+			return;
+		for(long i=0;i<n;i++)
+		{
+			if(count>lag)
+			{
+				std::fill(memory.begin(),memory.end(),T(0));
+				while(count>lag)
 					count -= lag;
 			}
 			count += 1.f;
-			out1 = memory1;
-			out2 = memory2;
-		} // if(on)
-		else
-		{
-			out1 = in1;
-			out2 = in2;
 		}
 	}
   
@@ -79,8 +110,9 @@ private:
 	float minfreq,maxfreq,startfreq,endfreq;
 	float sr;
 	float lag,count;
-	float memory1,memory2;
+	std::vector<T> memory;
 	bool on;
+	Random *random;
 };
 
 #endif
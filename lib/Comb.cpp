@@ -19,7 +19,8 @@
 
 #include "Comb.h"
 
-Comb::Comb()
+template<class T>
+Comb<T>::Comb()
 : mindelay(50)
 , maxdelay(50)
 , startdelay(50)
@@ -28,58 +29,108 @@ Comb::Comb()
 , type(FeedForward) //feedforward
 , sr(44100)
 , delay(2205)
-, dl1(2205,44100)
-, dl2(2205,44100) // 50 ms
 , on(true)
+, random(NULL)
 {
+  SetChannels(2);
   lp.SetSampleRate(44100);
   lp.SetTimeConstant(40.f); //40 ms
   lp.SetState(50.f);
+  fblp.SetSampleRate(44100);
+  fblp.SetTimeConstant(5.f); // within 1% after 20 ms
+  fblp.SetState(feedback);
 }
 
-void Comb::OnBlock(long bar, long sd)
+template<class T>
+void Comb<T>::OnBlock(long bar, long sd)
 {
-  startdelay = Math::randomfloat(mindelay,maxdelay);
-  enddelay = Math::randomfloat(mindelay,maxdelay);
+  startdelay = Math::randomfloat(*random,mindelay,maxdelay);
+  enddelay = Math::randomfloat(*random,mindelay,maxdelay);
 }
 
-void Comb::OnCut(long cut, long numcuts)
+template<class T>
+void Comb<T>::OnCut(long cut, long numcuts)
 {
   delay = (startdelay + (float(cut)/float(numcuts))*enddelay)*sr/1000.f;
   if(type==FeedForward) // feedforward
   {
-    dl1.set_delay(delay);
-    dl2.set_delay(delay);
+    for(size_t c=0;c<dl.size();c++)
+      dl[c]->set_delay(delay);
   }
 }
 
-void Comb::SetMinDelay(float v)
+template<class T>
+void Comb<T>::SetMinDelay(float v)
 {
   mindelay = v;
 }
 
-void Comb::SetMaxDelay(float v)
+template<class T>
+void Comb<T>::SetMaxDelay(float v)
 {
   maxdelay = v;
 }
 
-void Comb::SetType(long v)
+template<class T>
+void Comb<T>::SetType(long v)
 {
   type = v;
 }
 
-void Comb::SetFeedBack(float v)
+template<class T>
+void Comb<T>::SetFeedBack(float v, bool glide)
 {
   feedback = v;
+  if(!glide)
+    fblp.SetState(v);
 }
 
-void Comb::SetSampleRate(float v)
+template<class T>
+void Comb<T>::SetSampleRate(float v)
 {
   sr = v;
   lp.SetSampleRate(v);
+  fblp.SetSampleRate(v);
 }
 
-void Comb::SetOn(bool v)
+template<class T>
+void Comb<T>::SetOn(bool v)
 {
   on = v;
 }
+
+template<class T>
+void Comb<T>::SetRandom(Random *r)
+{
+  random = r;
+}
+
+template<class T>
+void Comb<T>::SetChannels(long v)
+{
+  dl.resize(v);
+  for(int c=0;c<v;c++)
+  {
+    if(!dl[c])
+      dl[c].reset(new DelayLine<T>(delay,44100)); // 50 ms
+  }
+}
+
+template<class T>
+long Comb<T>::TailSamples(float threshold) const
+{
+  if(!on)
+    return 0;
+  // OnCut sets delays up to the sum of the start and the end delay of a block
+  const double longest = std::ceil(2.0*std::max(mindelay,maxdelay)*sr/1000.0)+1.0;
+  // gliding down, the feedback is still above where it goes
+  const double gain = std::max(double(feedback),double(fblp.LastOut()));
+  if(type==FeedForward || gain<=0.0)
+    return long(longest);
+  // the output is clipped to 1, every round trip scales it by the feedback
+  const double trips = std::ceil(std::log(double(threshold))/std::log(std::min(gain,0.999)));
+  return long((trips+1.0)*longest);
+}
+
+template class Comb<float>;
+template class Comb<double>;
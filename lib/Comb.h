@@ -23,12 +23,16 @@
 #include "BBCutter.h"
 #include "DelayLine.h"
 #include "FirstOrderLowpass.h"
+#include <memory>
+#include <vector>
 
-inline float clip(float x)
+template<class T>
+inline T clip(T x)
 {
-  return std::max(std::min(x, 1.f), -1.f);
+  return std::max(std::min(x, T(1)), T(-1));
 }
 
+template<class T>
 class Comb : public BBCutListener
 {
 public:
@@ -46,46 +50,78 @@ public:
 	void SetMinDelay(float v);
 	void SetMaxDelay(float v);
 	void SetType(long v);
-	void SetFeedBack(float v);
+	// glides there within about 20 ms while processing, jumps there unless glide is set
+	void SetFeedBack(float v, bool glide);
 	void SetSampleRate(float v);
 	void SetOn(bool v);
+	void SetRandom(Random *r);
   
-	inline void tick(float &out1,float &out2, const float in1, const float in2)
+	// not real-time safe
+	void SetChannels(long v);
+  
+	// samples until what is left in the delay lines falls below threshold
+	long TailSamples(float threshold) const;
+  
+	// in place on n samples of every channel from offset on
+	inline void process(T *const *io, long offset, long n)
 	{
-		if(on)
+		if(!on)
+			return;
+		const long numchannels = dl.size();
+		if(type==FeedForward) // feedforward
 		{
-			if(type==FeedForward) // feedforward
+			for(long c=0;c<numchannels;c++)
 			{
-				out1 = 0.5f*(in1+dl1.tick(in1)); 
-				out2 = 0.5f*(in2+dl2.tick(in2));
-			} 
-			else // feedback
+				T *x = io[c]+offset;
+				DelayLine<T> &d = *dl[c];
+				for(long i=0;i<n;i++)
+					x[i] = 0.5f*(x[i]+d.tick(x[i]));
+			}
+		} 
+		else // feedback
+		{
+			// the delay is modulated per sample, all channels follow it
+			for(long i=0;i<n;i++)
 			{
 				// need delay interpolation
-				dl1.set_delay(lp.LastOut());
-				dl2.set_delay(lp.LastOut());
+				const float current = lp.LastOut();
 				lp.tick(delay);
-				out1 = clip((0.99f-feedback)*in1 + feedback*dl1.lastOut()); 
-				dl1.tick(out1);
-				out2 = clip((0.99f-feedback)*in2 + feedback*dl2.lastOut()); 
-				dl2.tick(out2);
+				const float g = fblp.tick(feedback);
+				for(long c=0;c<numchannels;c++)
+				{
+					DelayLine<T> &d = *dl[c];
+					d.set_delay(current);
+					T &x = io[c][offset+i];
+					x = clip((0.99f-g)*x + g*d.lastOut()); 
+					d.tick(x);
+				}
 			}
-		} 
-		else
+		}
+	}
+	
+	// as process on n samples of silence once the delay lines are below the threshold,
+	// only the glides go on
+	inline void Skip(long n)
+	{
+		if(!on || type==FeedForward)
+			return;
+		for(long i=0;i<n;i++)
 		{
-			out1 = in1;
-			out2 = in2;
+			lp.tick(delay);
+			fblp.tick(feedback);
 		}
 	}
 private:
 	float mindelay,maxdelay,startdelay,enddelay;//ms
-	DelayLine dl1,dl2;
+	std::vector<std::unique_ptr<DelayLine<T>>> dl;
 	float sr;
 	float feedback;
 	float delay;
 	FirstOrderLowpass lp;
+	FirstOrderLowpass fblp; // the feedback glide
 	bool on;
 	long type;
+	Random *random;
 };
 
 #endif
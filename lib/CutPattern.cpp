@@ -0,0 +1,192 @@
+/*
+ This file is part of Livecut
+ Copyright 2026 by the Livecut contributors.
+ 
+ Livecut can be redistributed and/or modified under the terms of the
+ GNU General Public License, as published by the Free Software Foundation;
+ either version 2 of the License, or (at your option) any later version.
+ 
+ Livecut is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Livecut; if not, visit www.gnu.org/licenses or write to the
+ Free Software Foundation, Inc., 59 Temple Place, Suite 330, 
+ Boston, MA 02111-1307 USA
+ */
+
+#include "CutPattern.h"
+#include "AliasTable.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+
+CutPattern::CutPattern()
+: rampchance(0.0)
+, rampfactor(1.0)
+, lookbackchance(0.0)
+{
+  phrases.start = blocks.start = repeats.start = lookbacks.start = 0;
+  phrases.length = blocks.length = repeats.length = lookbacks.length = 0;
+}
+
+long CutPattern::MaxLookback() const
+{
+  double units = 0.0;
+  for(long i=0;i<lookbacks.length;i++)
+    units = std::max(units,choices[lookbacks.start+i]);
+  return long(std::ceil(units));
+}
+
+static bool ParseNumber(const std::string &token, double &value)
+{
+  char *end = NULL;
+  value = std::strtod(token.c_str(),&end);
+  return !token.empty() && end == token.c_str()+token.size();
+}
+
+static bool Fail(long line, const std::string &message, std::string &error)
+{
+  std::ostringstream os;
+  os << "line " << line << ": " << message;
+  error = os.str();
+  return false;
+}
+
+// a weighted list from args[first] on, appended to the choices
+static bool ParseList(const std::vector<std::string> &args, size_t first,
+                      CutPattern &pattern, CutPattern::Span &span, std::string &error)
+{
+  if(args.size() <= first)
+  {
+    error = "needs at least one value";
+    return false;
+  }
+  span.start = long(pattern.choices.size());
+  span.length = long(args.size()-first);
+  for(size_t i=first;i<args.size();i++)
+  {
+    const std::string::size_type colon = args[i].find(':');
+    double value = 0.0, weight = 1.0;
+    if(!ParseNumber(args[i].substr(0,colon),value) ||
+       (colon != std::string::npos && !ParseNumber(args[i].substr(colon+1),weight)))
+    {
+      error = "has a bad value '"+args[i]+"'";
+      return false;
+    }
+    if(value < 1.0 || weight <= 0.0)
+    {
+      error = "values must be 1 or more and weights positive";
+      return false;
+    }
+    pattern.choices.push_back(value);
+    pattern.weights.push_back(weight);
+  }
+  return true;
+}
+
+// draws from a weighted list take O(1), whatever its length
+static void BuildAlias(CutPattern &pattern, const CutPattern::Span &span)
+{
+  if(span.length == 0)
+    return;
+  std::vector<double> scaled(span.length);
+  std::vector<long> small(span.length), large(span.length);
+  BuildAliasTable(pattern.weights.data()+span.start,span.length,
+                  pattern.aliasprob.data()+span.start,pattern.alias.data()+span.start,
+                  scaled.data(),small.data(),large.data());
+}
+
+bool CompileCutPattern(const std::string &text, CutPattern &pattern, std::string &error)
+{
+  CutPattern compiled;
+  std::istringstream lines(text);
+  std::string line;
+  long number = 0;
+  
+  while(std::getline(lines,line))
+  {
+    number++;
+    const std::string::size_type comment = line.find('#');
+    if(comment != std::string::npos)
+      line.erase(comment);
+    
+    std::istringstream tokens(line);
+    std::string keyword;
+    if(!(tokens >> keyword))
+      continue;
+    
+    std::vector<std::string> args;
+    std::string token;
+    while(tokens >> token)
+      args.push_back(token);
+    
+    if(keyword == "phrase" || keyword == "block" || keyword == "repeat")
+    {
+      CutPattern::Span &span = (keyword == "phrase")? compiled.phrases :
+                               (keyword == "block")? compiled.blocks : compiled.repeats;
+      if(span.length > 0)
+        return Fail(number,keyword+" given twice",error);
+      if(!ParseList(args,0,compiled,span,error))
+        return Fail(number,keyword+" "+error,error);
+    }
+    else if(keyword == "lookback")
+    {
+      if(compiled.lookbacks.length > 0)
+        return Fail(number,keyword+" given twice",error);
+      if(args.empty() || !ParseNumber(args[0],compiled.lookbackchance) ||
+         compiled.lookbackchance < 0.0 || compiled.lookbackchance > 1.0)
+        return Fail(number,"lookback needs a chance in [0,1]",error);
+      if(!ParseList(args,1,compiled,compiled.lookbacks,error))
+        return Fail(number,keyword+" "+error,error);
+    }
+    else if(keyword == "ramp")
+    {
+      if(args.size() != 2 ||
+         !ParseNumber(args[0],compiled.rampchance) ||
+         !ParseNumber(args[1],compiled.rampfactor))
+        return Fail(number,"ramp needs a chance and a factor",error);
+      if(compiled.rampchance < 0.0 || compiled.rampchance > 1.0 || compiled.rampfactor <= 0.0)
+        return Fail(number,"the ramp chance must be in [0,1] and the factor positive",error);
+    }
+    else if(keyword == "fill")
+    {
+      CutPattern::Span fill = { long(compiled.fillblocks.size()), 0 };
+      CutPattern::Span block = { long(compiled.fillbeats.size()), 0 };
+      for(size_t i=0;i<=args.size();i++)
+      {
+        if(i == args.size() || args[i] == "/")
+        {
+          if(block.length == 0)
+            return Fail(number,"empty fill block",error);
+          compiled.fillblocks.push_back(block);
+          fill.length++;
+          block.start = long(compiled.fillbeats.size());
+          block.length = 0;
+          continue;
+        }
+        double beats = 0.0;
+        if(!ParseNumber(args[i],beats) || beats <= 0.0)
+          return Fail(number,"bad fill length '"+args[i]+"'",error);
+        compiled.fillbeats.push_back(beats);
+        block.length++;
+      }
+      compiled.fills.push_back(fill);
+    }
+    else
+      return Fail(number,"unknown statement '"+keyword+"'",error);
+  }
+  
+  compiled.aliasprob.assign(compiled.weights.size(),1.0);
+  compiled.alias.assign(compiled.weights.size(),0);
+  BuildAlias(compiled,compiled.phrases);
+  BuildAlias(compiled,compiled.blocks);
+  BuildAlias(compiled,compiled.repeats);
+  BuildAlias(compiled,compiled.lookbacks);
+  
+  pattern = compiled;
+  return true;
+}
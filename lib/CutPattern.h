@@ -0,0 +1,75 @@
+/*
+ This file is part of Livecut
+ Copyright 2026 by the Livecut contributors.
+ 
+ Livecut can be redistributed and/or modified under the terms of the
+ GNU General Public License, as published by the Free Software Foundation;
+ either version 2 of the License, or (at your option) any later version.
+ 
+ Livecut is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Livecut; if not, visit www.gnu.org/licenses or write to the
+ Free Software Foundation, Inc., 59 Temple Place, Suite 330, 
+ Boston, MA 02111-1307 USA
+ */
+
+#ifndef LIVECUT_CUT_PATTERN_H
+#define LIVECUT_CUT_PATTERN_H
+
+#include <string>
+#include <vector>
+
+/**
+ @brief a cut procedure described by text and compiled into flat tables.
+ 
+ one statement per line, # starts a comment. weighted lists are value:weight
+ pairs, the weight defaults to 1.
+ 
+   phrase 1:1 2:2 4:1     phrase lengths in bars, the Min/Max Phrase range if missing
+   block 1:5 2:4 4:1      block lengths in units, 1 if missing
+   repeat 1:6 2:3 4:1     cuts per block, 1 if missing
+   ramp 0.3 0.8           chance of a ramped block and the size factor from cut to cut.
+                          pan, amp and detune glide across a ramped block
+   lookback 0.2 2 4:2     chance of a block replaying the input from earlier, and how
+                          many units before the block it reads from
+   fill 0.5 1 / 1 / 1     a fill for the last bar of a phrase, one of them chosen
+                          per phrase. blocks are split by /, cut lengths in beats
+ 
+ compiling allocates, the tables are read-only afterwards.
+ */
+struct CutPattern
+{
+  struct Span
+  {
+    long start,length;
+  };
+  
+  CutPattern();
+  
+  // the weighted lists, back to back, and their alias tables built when compiling.
+  // the weights are constants of the text, no parameter changes them
+  std::vector<double> choices;
+  std::vector<double> weights;
+  std::vector<double> aliasprob;
+  std::vector<long> alias; // relative to the start of the list
+  Span phrases, blocks, repeats, lookbacks;
+  double rampchance, rampfactor;
+  double lookbackchance;
+  
+  // units the furthest lookback reads from before its block, 0 without lookbacks
+  long MaxLookback() const;
+  
+  // a fill is a span of blocks, a block a span of beats
+  std::vector<double> fillbeats;
+  std::vector<Span> fillblocks;
+  std::vector<Span> fills;
+};
+
+// false with a message naming the line when the text is not a valid pattern
+bool CompileCutPattern(const std::string &text, CutPattern &pattern, std::string &error);
+
+#endif
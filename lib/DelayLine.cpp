@@ -20,7 +20,8 @@
 #include "DelayLine.h"
 #include <cstring>
 
-DelayLine::DelayLine(float delay, long size)
+template<class T>
+DelayLine<T>::DelayLine(float delay, long size)
 : mpBuffer(0)
 , mLastOut(0)
 , mDelay(delay)
@@ -31,18 +32,20 @@ DelayLine::DelayLine(float delay, long size)
   int n = int(floor (log(double(size))/log(2.0) + 0.5))+1;
   mMask = 1 ; mMask <<= n; mMask -= 1;
   mSize = mMask+1;
-  mpBuffer = new float[mSize];
+  mpBuffer = new T[mSize];
   clear();
 }
 
-DelayLine::~DelayLine()
+template<class T>
+DelayLine<T>::~DelayLine()
 {
   if(0 != mpBuffer)
     delete[] mpBuffer;
   mpBuffer = 0;
 }
 
-void DelayLine::resize(int size)
+template<class T>
+void DelayLine<T>::resize(int size)
 {
   int n = int(floor (log(double(size))/log(2.0) + 0.5))+1;
   // when N is a multiple of 2 we choose the next power of 2...
@@ -52,18 +55,20 @@ void DelayLine::resize(int size)
   if(0 != mpBuffer)
     delete[] mpBuffer;
   mpBuffer = 0;
-  mpBuffer = new float[mSize];
+  mpBuffer = new T[mSize];
   mWriteIndex = 0;
   clear();
 }
 
 
-void DelayLine::set_delay(float delay)
+template<class T>
+void DelayLine<T>::set_delay(float delay)
 {
   mDelay = delay;
 }
 
-void DelayLine::replace(const float x[],int pos,int size)
+template<class T>
+void DelayLine<T>::replace(const T x[],int pos,int size)
 {
   auto p = (mWriteIndex+pos); p &= mMask;
   auto n = mSize-p;
@@ -72,7 +77,7 @@ void DelayLine::replace(const float x[],int pos,int size)
   else
     n = n;
   
-  float *dest = mpBuffer+p;
+  T *dest = mpBuffer+p;
   int i=0;
   for(;i<n;i++)
   {
@@ -85,7 +90,8 @@ void DelayLine::replace(const float x[],int pos,int size)
   }
 }
 
-void DelayLine::write(const float x[],int pos,int size)
+template<class T>
+void DelayLine<T>::write(const T x[],int pos,int size)
 {
   auto p = (mWriteIndex+pos); p &= mMask;
   auto n = mSize-p;
@@ -94,7 +100,7 @@ void DelayLine::write(const float x[],int pos,int size)
   else
     n = n;
   
-  float *dest = mpBuffer+p;
+  T *dest = mpBuffer+p;
   int i=0;
   for(;i<n;i++)
   {
@@ -108,7 +114,8 @@ void DelayLine::write(const float x[],int pos,int size)
 }
 
 
-void DelayLine::read(float dest[],int pos,int size)
+template<class T>
+void DelayLine<T>::read(T dest[],int pos,int size)
 {
   auto p = (mWriteIndex+(pos+mSize));
   p    &= mMask;
@@ -116,21 +123,25 @@ void DelayLine::read(float dest[],int pos,int size)
   
   if(size<n)
   {
-    std::memcpy(dest,mpBuffer+p,size*sizeof(float));
+    std::memcpy(dest,mpBuffer+p,size*sizeof(T));
   }
   else
   {
-    std::memcpy(dest,mpBuffer+p,n*sizeof(float));
-    std::memcpy(dest,mpBuffer,(size-n)*sizeof(float));
+    std::memcpy(dest,mpBuffer+p,n*sizeof(T));
+    std::memcpy(dest,mpBuffer,(size-n)*sizeof(T));
   }
 }
 
-void DelayLine::clear()
+template<class T>
+void DelayLine<T>::clear()
 {
   for(int i=0;i<mSize;i++)
   {
-    mpBuffer[i] = 0.0f;
+    mpBuffer[i] = T(0);
   }
-  mLastOut=0.0f;
+  mLastOut=T(0);
 }
 
+template class DelayLine<float>;
+template class DelayLine<double>;
+
@@ -23,14 +23,16 @@
 #include "float_cast.h"
 
 //-------------------------------------------------------
-inline float linear_interpolation(const float* data, unsigned long mask, float pos)
+template<class T>
+inline T linear_interpolation(const T* data, unsigned long mask, float pos)
 {
 	auto ipos = lrintf(pos);
-	float frac = float(pos-ipos);
-	return (1.0f-frac)*data[ipos&mask] + frac*data[(ipos+1)&mask];
+	T frac = T(pos-ipos);
+	return (T(1)-frac)*data[ipos&mask] + frac*data[(ipos+1)&mask];
 }
 
 //-------------------------------------------------------
+template<class T>
 class DelayLine
 {
 public:
@@ -41,7 +43,7 @@ public:
   
   void set_delay(float delay);
   
-  inline float tick(const float x)
+  inline T tick(const T x)
 	{
 		mpBuffer[mWriteIndex] = x; 
 		const float pos = float(mWriteIndex+mSize)-mDelay;
@@ -49,52 +51,52 @@ public:
 		return (mLastOut = linear_interpolation(mpBuffer,mMask,pos));
 	}
 	
-  void replace(const float x[],int pos,int size);
-	void write(const float x[],int pos,int size);
+  void replace(const T x[],int pos,int size);
+	void write(const T x[],int pos,int size);
 
-  inline void write(const float x)
+  inline void write(const T x)
 	{
 		mpBuffer[mWriteIndex] = x;
 		mWriteIndex++; mWriteIndex &= mMask;
   }
   
-  inline float read()
+  inline T read()
 	{
-		float tmp = mpBuffer[mWriteIndex];
+		T tmp = mpBuffer[mWriteIndex];
 		mWriteIndex++;mWriteIndex &= mMask;
 		return tmp;
 	}
   
-  inline float tap(const long samples)
+  inline T tap(const long samples)
 	{
 		return mpBuffer[(mWriteIndex+mSize-samples)&mMask];
 	}
   
-  inline float tapL(const float samples)
+  inline T tapL(const float samples)
 	{
 		const float pos = float(mWriteIndex+mSize)-samples;
 		return linear_interpolation(mpBuffer,mMask,pos);
 	}
   
-  inline float readErase()
+  inline T readErase()
 	{
-		float tmp = mpBuffer[mWriteIndex];
-		mpBuffer[mWriteIndex] = 0.0f; //erase automatically after read
+		T tmp = mpBuffer[mWriteIndex];
+		mpBuffer[mWriteIndex] = T(0); //erase automatically after read
 		mWriteIndex++; mWriteIndex &= mMask;
 		return tmp;
 	}
   
-  void read(float dest[],int pos,int size);
+  void read(T dest[],int pos,int size);
   
   void clear();
   
-  float* get_ptr(int pos=0)	{return &(mpBuffer[(mWriteIndex+pos)&mMask]);}
+  T* get_ptr(int pos=0)	{return &(mpBuffer[(mWriteIndex+pos)&mMask]);}
   
-  inline float lastOut()  {return mLastOut;}
+  inline T lastOut()  {return mLastOut;}
   
 private:
-  float* mpBuffer;
-  float mLastOut;
+  T* mpBuffer;
+  T mLastOut;
   float mDelay;
   long mWriteIndex;
   long mMask;
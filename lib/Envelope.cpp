@@ -0,0 +1,196 @@
+/*
+ This file is part of Livecut
+ Copyright 2026 by the Livecut contributors.
+ 
+ Livecut can be redistributed and/or modified under the terms of the
+ GNU General Public License, as published by the Free Software Foundation;
+ either version 2 of the License, or (at your option) any later version.
+ 
+ Livecut is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Livecut; if not, visit www.gnu.org/licenses or write to the
+ Free Software Foundation, Inc., 59 Temple Place, Suite 330, 
+ Boston, MA 02111-1307 USA
+ */
+
+
+#include "Envelope.h"
+#include <algorithm>
+#include <cmath>
+
+static const double envpi = 3.14159265358979323846;
+
+void Envelope::Ramp::Start(long shape, double fade, double x0, double dir)
+{
+  this->shape = shape;
+  switch(shape)
+  {
+    case kTrapezoid:
+      x = x0/fade;
+      step = dir/fade;
+      break;
+    case kRaisedCosine:
+      c = cos(envpi*x0/fade);
+      s = sin(envpi*x0/fade);
+      cosstep = cos(envpi*dir/fade);
+      sinstep = sin(envpi*dir/fade);
+      break;
+    case kEqualPower:
+      c = cos(0.5*envpi*x0/fade);
+      s = sin(0.5*envpi*x0/fade);
+      cosstep = cos(0.5*envpi*dir/fade);
+      sinstep = sin(0.5*envpi*dir/fade);
+      break;
+    default:
+      // 1-exp(-5x/fade), x holds the exponential
+      x = exp(-5.0*x0/fade);
+      step = exp(-5.0*dir/fade);
+      break;
+  }
+}
+
+void Envelope::Ramp::Apply(float *env, long n)
+{
+  switch(shape)
+  {
+    case kTrapezoid:
+      for(long i=0;i<n;++i)
+      {
+        env[i] *= float(x);
+        x += step;
+      }
+      break;
+    case kRaisedCosine:
+    case kEqualPower:
+      for(long i=0;i<n;++i)
+      {
+        env[i] *= float((shape==kRaisedCosine)? 0.5-0.5*c : s);
+        const double t = c*cosstep - s*sinstep;
+        s = s*cosstep + c*sinstep;
+        c = t;
+      }
+      break;
+    default:
+      for(long i=0;i<n;++i)
+      {
+        env[i] *= float(1.0-x);
+        x *= step;
+      }
+      break;
+  }
+}
+
+Envelope::Envelope()
+: overlap(false)
+, tailvalid(false)
+, shape(kExponential)
+, fade(1.f)
+, length(-1)
+, filled(0)
+, fadingout(false)
+{
+}
+
+void Envelope::Prepare(long maxlength)
+{
+  table.assign(maxlength,1.f);
+  tail.assign(maxlength,0.f);
+  tailvalid = false;
+  length = -1;
+  filled = 0;
+}
+
+void Envelope::SetShape(long v)
+{
+  if(v<0 || v>=kNumEnvelopeShapes)
+    v = kExponential;
+  if(v!=shape)
+  {
+    shape = v;
+    length = -1;
+    tailvalid = false;
+  }
+}
+
+void Envelope::SetFade(float v)
+{
+  if(v!=fade)
+  {
+    fade = v;
+    length = -1;
+    tailvalid = false;
+  }
+}
+
+void Envelope::SetOverlap(bool v)
+{
+  if(v!=overlap)
+  {
+    overlap = v;
+    length = -1;
+  }
+}
+
+void Envelope::Start(long v)
+{
+  if(v==length)
+    return; // reuse what has been computed so far
+  
+  length = v;
+  filled = 0;
+  fadingout = false;
+  in.Start(shape,fade,0.0,1.0);
+}
+
+long Envelope::Region() const
+{
+  // 1-exp(-20) rounds to 1.f, the other shapes reach 1 at the fade length
+  if(shape==kExponential)
+    return long(std::ceil(4.f*fade));
+  return long(fade);
+}
+
+void Envelope::Fill(long upto)
+{
+  upto = std::min(upto,long(table.size()));
+  if(upto<=filled)
+    return;
+  
+  float *env = table.data();
+  std::fill(env+filled,env+upto,1.f);
+  
+  const long region = Region();
+  
+  //fade in
+  const long inend = std::min(upto,region);
+  if(filled<inend)
+    in.Apply(env+filled,inend-filled);
+  
+  //fade out, mirrored. played as a tail in overlap mode
+  const long outstart = std::max(filled,length-region);
+  if(!overlap && outstart<upto)
+  {
+    if(!fadingout)
+    {
+      out.Start(shape,fade,double(length-outstart),-1.0);
+      fadingout = true;
+    }
+    out.Apply(env+outstart,upto-outstart);
+  }
+  
+  filled = upto;
+}
+
+void Envelope::FillTail()
+{
+  const long n = TailLength();
+  std::fill(tail.begin(),tail.begin()+n,1.f);
+  Ramp ramp;
+  ramp.Start(shape,fade,double(Region()),-1.0);
+  ramp.Apply(tail.data(),n);
+  tailvalid = true;
+}
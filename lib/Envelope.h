@@ -0,0 +1,104 @@
+/*
+ This file is part of Livecut
+ Copyright 2026 by the Livecut contributors.
+ 
+ Livecut can be redistributed and/or modified under the terms of the
+ GNU General Public License, as published by the Free Software Foundation;
+ either version 2 of the License, or (at your option) any later version.
+ 
+ Livecut is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Livecut; if not, visit www.gnu.org/licenses or write to the
+ Free Software Foundation, Inc., 59 Temple Place, Suite 330, 
+ Boston, MA 02111-1307 USA
+ */
+
+
+#ifndef LIVECUT_ENVELOPE_H
+#define LIVECUT_ENVELOPE_H
+
+#include <algorithm>
+#include <vector>
+
+enum EnvelopeShape
+{
+  kExponential=0,
+  kTrapezoid,
+  kRaisedCosine,
+  kEqualPower,
+  kNumEnvelopeShapes
+};
+
+/**
+ @brief cut envelope, the product of a fade in and a mirrored fade out.
+ the values are computed lazily into a table with a multiply-add recurrence,
+ the table is kept as long as shape, fade and length don't change,
+ so repeated cuts of a stutter roll cost nothing.
+ in overlap mode the cut only fades in and the fade out is played by the
+ caller as a tail past the end of the cut, under the head of the next one.
+ */
+class Envelope
+{
+public:
+  Envelope();
+  
+  // allocates the table, not real-time safe
+  void Prepare(long maxlength);
+  
+  void SetShape(long v);
+  void SetFade(float v); // samples
+  void SetOverlap(bool v);
+  inline bool Overlap() const { return overlap; }
+  
+  // start of a cut with length samples of duty cycle on
+  void Start(long length);
+  
+  // n envelope values starting at pos, pos+n must not exceed the length
+  inline const float *Get(long pos, long n)
+  {
+    if(pos+n>filled)
+      Fill(pos+n);
+    return table.data()+pos;
+  }
+  
+  // fade out played past the end of a cut in overlap mode, mirrors the fade in
+  inline long TailLength() const { return std::min(Region(),long(tail.size())); }
+  inline const float *Tail()
+  {
+    if(!tailvalid)
+      FillTail();
+    return tail.data();
+  }
+  
+private:
+  // fade in for x = x0, x0+dir, x0+2*dir, ... samples into the fade
+  struct Ramp
+  {
+    void Start(long shape, double fade, double x0, double dir);
+    void Apply(float *env, long n); // multiplies n values
+    
+    long shape;
+    double x,step;
+    double c,s,cosstep,sinstep;
+  };
+  
+  void Fill(long upto);
+  void FillTail();
+  long Region() const;
+  
+  std::vector<float> table;
+  std::vector<float> tail;
+  bool overlap;
+  bool tailvalid;
+  long shape;
+  float fade;
+  long length, filled;
+  bool fadingout;
+  Ramp in,out;
+};
+
+#endif
@@ -35,7 +35,7 @@ public:
 		return lastout;
 	}
 	
-  inline float LastOut() 
+  inline float LastOut() const
   {
     return lastout;
   }
@@ -0,0 +1,126 @@
+/*
+ This file is part of Livecut
+ Copyright 2026 by the Livecut contributors.
+ 
+ Livecut can be redistributed and/or modified under the terms of the
+ GNU General Public License, as published by the Free Software Foundation;
+ either version 2 of the License, or (at your option) any later version.
+ 
+ Livecut is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Livecut; if not, visit www.gnu.org/licenses or write to the
+ Free Software Foundation, Inc., 59 Temple Place, Suite 330, 
+ Boston, MA 02111-1307 USA
+ */
+
+
+#ifndef LIVECUT_PAN_MATRIX_H
+#define LIVECUT_PAN_MATRIX_H
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64)
+#include <xmmintrin.h>
+#define LIVECUT_PAN_MATRIX_SSE 1
+#endif
+
+/**
+ @brief stereo rotation matrix of a cut, amp and equal power pan.
+ [ll lr]
+ [rl rr]
+ every left/right channel pair is rotated by it, one output channel at a time.
+ */
+struct PanMatrix
+{
+  PanMatrix() : ll(0.f), lr(0.f), rl(0.f), rr(0.f) {}
+  
+  // pan in [-1,1], negative pans rotate right into left
+  inline void Set(float amp, float pan)
+  {
+    float c,s;
+    EqualPower(pan<0.f? -pan : pan,c,s);
+    ll = amp * ((pan<0.f)? 1.f : c);
+    lr = amp * ((pan<0.f)? 0.f : s);
+    rl = amp * ((pan>0.f)? 0.f : s);
+    rr = amp * ((pan>0.f)? 1.f : c);
+  }
+  
+  // c = cos(x*pi/2), s = sin(x*pi/2) for x in [0,1], c*c+s*s stays within 1e-5 of 1
+  static inline void EqualPower(float x, float &c, float &s)
+  {
+    c = Cos(x);
+    s = Cos(1.f-x);
+  }
+  
+  // out = env * (gx*x + gy*y), one output channel of the rotation.
+  // out must not overlap x, y or env
+  template<class T>
+  static inline void Mix(const T *x, const T *y, const float *env,
+                         float gx, float gy, T *out, long n)
+  {
+    for(long i=0;i<n;++i)
+      out[i] = env[i]*(gx*x[i] + gy*y[i]);
+  }
+  
+  static inline void Mix(const float *x, const float *y, const float *env,
+                         float gx, float gy, float *out, long n)
+  {
+    long i=0;
+#if LIVECUT_PAN_MATRIX_SSE
+    const __m128 a = _mm_set1_ps(gx);
+    const __m128 b = _mm_set1_ps(gy);
+    for(;i+4<=n;i+=4)
+    {
+      const __m128 u = _mm_loadu_ps(x+i);
+      const __m128 v = _mm_loadu_ps(y+i);
+      const __m128 e = _mm_loadu_ps(env+i);
+      _mm_storeu_ps(out+i,_mm_mul_ps(e,_mm_add_ps(_mm_mul_ps(a,u),_mm_mul_ps(b,v))));
+    }
+#endif
+    for(;i<n;++i)
+      out[i] = env[i]*(gx*x[i] + gy*y[i]);
+  }
+  
+  // out += env * (gx*x + gy*y), for voices mixed on top of each other
+  template<class T>
+  static inline void MixAdd(const T *x, const T *y, const float *env,
+                            float gx, float gy, T *out, long n)
+  {
+    for(long i=0;i<n;++i)
+      out[i] += env[i]*(gx*x[i] + gy*y[i]);
+  }
+  
+  static inline void MixAdd(const float *x, const float *y, const float *env,
+                            float gx, float gy, float *out, long n)
+  {
+    long i=0;
+#if LIVECUT_PAN_MATRIX_SSE
+    const __m128 a = _mm_set1_ps(gx);
+    const __m128 b = _mm_set1_ps(gy);
+    for(;i+4<=n;i+=4)
+    {
+      const __m128 u = _mm_loadu_ps(x+i);
+      const __m128 v = _mm_loadu_ps(y+i);
+      const __m128 e = _mm_loadu_ps(env+i);
+      const __m128 o = _mm_loadu_ps(out+i);
+      _mm_storeu_ps(out+i,_mm_add_ps(o,_mm_mul_ps(e,_mm_add_ps(_mm_mul_ps(a,u),_mm_mul_ps(b,v)))));
+    }
+#endif
+    for(;i<n;++i)
+      out[i] += env[i]*(gx*x[i] + gy*y[i]);
+  }
+  
+  float ll,lr,rl,rr;
+  
+private:
+  // even polynomial for cos(x*pi/2) on [0,1]
+  static inline float Cos(float x)
+  {
+    const float x2 = x*x;
+    return 1.f + x2*(-1.2337005f + x2*(0.2536695f + x2*(-0.0208635f + x2*0.0009192f)));
+  }
+};
+
+#endif
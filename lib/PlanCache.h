@@ -0,0 +1,308 @@
+/*
+ This file is part of Livecut
+ Copyright 2026 by the Livecut contributors.
+ 
+ Livecut can be redistributed and/or modified under the terms of the
+ GNU General Public License, as published by the Free Software Foundation;
+ either version 2 of the License, or (at your option) any later version.
+ 
+ Livecut is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Livecut; if not, visit www.gnu.org/licenses or write to the
+ Free Software Foundation, Inc., 59 Temple Place, Suite 330, 
+ Boston, MA 02111-1307 USA
+ */
+
+#ifndef LIVECUT_PLAN_CACHE_H
+#define LIVECUT_PLAN_CACHE_H
+
+#include "Random.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// identifies a phrase: what it was planned with and where it starts
+struct PlanKey
+{
+  uint64_t settings; // hash of the procedure, its parameters and the seed
+  long bar; // the phrase starts on
+  
+  inline bool operator==(const PlanKey &k) const
+  {
+    return settings == k.settings && bar == k.bar;
+  }
+};
+
+// field by field, padding never reaches the hash
+class PlanHash
+{
+public:
+  PlanHash() : h(0) {}
+  
+  inline PlanHash &Add(uint64_t v) { h = CounterRandom::Mix(h ^ v) + 0x9e3779b97f4a7c15ull; return *this; }
+  inline PlanHash &Add(long v) { return Add(uint64_t(v)); }
+  inline PlanHash &Add(double v)
+  {
+    uint64_t bits;
+    std::memcpy(&bits,&v,sizeof(bits));
+    return Add(bits);
+  }
+  inline uint64_t Value() const { return h; }
+  
+private:
+  uint64_t h;
+};
+
+/**
+ @brief the cut plans of whole phrases by PlanKey.
+ with the random numbers keyed by position, a phrase is a function of its key,
+ so a looped region replays its phrases instead of planning them again.
+ all memory is allocated by SetBudget(). phrases are recorded block by block
+ into rings of blocks and cuts and found in O(1) through an open addressing
+ index. a phrase found is copied over to the newest end of the rings, so the
+ least recently used phrases are overwritten first. recording, lookups and
+ replay never allocate, so the planner may use the cache on the audio thread.
+ */
+template<class Cut>
+class PlanCache
+{
+public:
+  struct Block
+  {
+    long units;
+    uint64_t first; // cut, counted from the start of the cut ring
+    long count;
+  };
+  
+  struct Phrase
+  {
+    PlanKey key;
+    long totalunits;
+    uint64_t block; // first block, counted from the start of the block ring
+    long blocks;
+    uint64_t cut; // first cut, counted alike
+    bool moved; // found again, its copy at the newest end is the one indexed
+  };
+  
+  PlanCache() : recording(false) { Clear(); }
+  
+  // 0 disables the cache. the rings hold about kCutsPerBlock cuts per block,
+  // a phrase has a few blocks at least. not real-time safe
+  void SetBudget(size_t bytes)
+  {
+    const size_t perblock = sizeof(Block)+kCutsPerBlock*sizeof(Cut);
+    size_t numblocks = bytes >= perblock? 1 : 0;
+    while(numblocks && numblocks*2*perblock <= bytes)
+      numblocks *= 2;
+    blockring.assign(numblocks,Block());
+    cutring.assign(numblocks*kCutsPerBlock,Cut());
+    phrases.assign(std::max(numblocks/2,size_t(1)),Phrase());
+    index.assign(numblocks? 2*phrases.size() : 0,-1);
+    Clear();
+  }
+  inline bool Enabled() const { return !blockring.empty(); }
+  
+  void Clear()
+  {
+    std::fill(index.begin(),index.end(),-1);
+    cutswritten = blockswritten = 0;
+    oldest = newest = 0;
+    recording = false;
+  }
+  
+  // NULL when missing. valid until the next Find(), Append() or End().
+  // a recording underway is dropped when the phrase found is moved
+  const Phrase *Find(const PlanKey &key)
+  {
+    const long slot = Slot(key);
+    if(slot < 0 || index[slot] < 0)
+      return NULL;
+    if(index[slot] != long((newest-1)%phrases.size()))
+      Touch(index[slot]);
+    return &phrases[index[Slot(key)]];
+  }
+  inline const Block &BlockOf(const Phrase &phrase, long i) const
+  {
+    return blockring[(phrase.block+i) % blockring.size()];
+  }
+  // the cuts of a block may wrap around the end of the ring
+  void CopyCuts(const Block &block, Cut *out) const
+  {
+    const size_t size = cutring.size();
+    for(long i=0;i<block.count;i++)
+      out[i] = cutring[(block.first+i) % size];
+  }
+  
+  // a phrase is recorded block by block and can be found once it has ended
+  void Begin(const PlanKey &key, long totalunits)
+  {
+    current.key = key;
+    current.totalunits = totalunits;
+    current.block = blockswritten;
+    current.blocks = 0;
+    current.cut = cutswritten;
+    recording = Enabled();
+  }
+  
+  // false when the phrase outgrows the cache, it is dropped then
+  bool Append(long units, const Cut *cuts, long count)
+  {
+    if(!recording)
+      return false;
+    const uint64_t size = cutring.size();
+    const uint64_t cutend = cutswritten+count;
+    const uint64_t blockend = blockswritten+1;
+    if(cutend-current.cut > size || blockend-current.block > blockring.size())
+    {
+      recording = false;
+      return false;
+    }
+    MakeRoom(cutend,blockend);
+    
+    for(long i=0;i<count;i++)
+      cutring[(cutswritten+i) % size] = cuts[i];
+    Block &block = blockring[blockswritten%blockring.size()];
+    block.units = units;
+    block.first = cutswritten;
+    block.count = count;
+    cutswritten = cutend;
+    blockswritten = blockend;
+    current.blocks++;
+    return true;
+  }
+  
+  void End()
+  {
+    if(!recording)
+      return;
+    recording = false;
+    const long slot = Slot(current.key);
+    if(slot < 0 || index[slot] >= 0)
+      return;
+    current.moved = false;
+    Add(current);
+  }
+  
+private:
+  enum { kCutsPerBlock = 4 };
+  
+  inline Phrase &Oldest() { return phrases[oldest%phrases.size()]; }
+  
+  // the phrases whose blocks or cuts would be overwritten up to the ends go first
+  void MakeRoom(uint64_t cutend, uint64_t blockend)
+  {
+    while(oldest != newest && (Oldest().cut+cutring.size() < cutend ||
+                               Oldest().block+blockring.size() < blockend))
+      Evict();
+  }
+  
+  // the entry goes to the newest end and is indexed by its key
+  void Add(const Phrase &phrase)
+  {
+    if(newest-oldest == phrases.size())
+      Evict();
+    // the eviction may have moved the slot of the key
+    const long slot = Slot(phrase.key);
+    const long entry = long(newest%phrases.size());
+    phrases[entry] = phrase;
+    index[slot] = entry;
+    newest++;
+  }
+  
+  // copies a phrase over to the newest end of the rings. the copy is ahead of the
+  // original by at least its length and at most a ring, so copying forwards
+  // only ever overwrites what has been copied already
+  void Touch(long entry)
+  {
+    Phrase phrase = phrases[entry];
+    phrases[entry].moved = true;
+    recording = false;
+    const uint64_t cutshift = cutswritten-phrase.cut;
+    const uint64_t blockshift = blockswritten-phrase.block;
+    const uint64_t cutend = cutswritten+(phrase.blocks > 0? LastCut(phrase)-phrase.cut : 0);
+    const uint64_t blockend = blockswritten+phrase.blocks;
+    MakeRoom(cutend,blockend);
+    
+    const size_t cutsize = cutring.size(), blocksize = blockring.size();
+    for(uint64_t i=phrase.cut;i+cutshift<cutend;i++)
+      cutring[(i+cutshift) % cutsize] = cutring[i % cutsize];
+    for(long i=0;i<phrase.blocks;i++)
+    {
+      Block block = blockring[(phrase.block+i) % blocksize];
+      block.first += cutshift;
+      blockring[(phrase.block+blockshift+i) % blocksize] = block;
+    }
+    phrase.cut = cutswritten;
+    phrase.block = blockswritten;
+    cutswritten = cutend;
+    blockswritten = blockend;
+    Add(phrase);
+  }
+  
+  inline uint64_t LastCut(const Phrase &phrase) const
+  {
+    const Block &last = BlockOf(phrase,phrase.blocks-1);
+    return last.first+last.count;
+  }
+  
+  // the index slot holding the key or the empty slot it would go to, linear probing.
+  // the index is twice the phrases, there is always an empty slot
+  long Slot(const PlanKey &key) const
+  {
+    if(index.empty())
+      return -1;
+    const size_t mask = index.size()-1;
+    size_t slot = Hash(key) & mask;
+    while(index[slot] >= 0 && !(phrases[index[slot]].key == key))
+      slot = (slot+1) & mask;
+    return long(slot);
+  }
+  
+  // drops the oldest phrase, the entries after its slot are moved back so that
+  // every probe sequence stays unbroken
+  void Evict()
+  {
+    if(Oldest().moved)
+    {
+      oldest++;
+      return; // its copy keeps the slot
+    }
+    const size_t mask = index.size()-1;
+    size_t slot = size_t(Slot(Oldest().key));
+    oldest++;
+    index[slot] = -1;
+    for(size_t next=(slot+1)&mask;index[next] >= 0;next=(next+1)&mask)
+    {
+      const size_t home = Hash(phrases[index[next]].key) & mask;
+      // moved back unless its home lies cyclically in (slot,next]
+      if(((next-home)&mask) >= ((next-slot)&mask))
+      {
+        index[slot] = index[next];
+        index[next] = -1;
+        slot = next;
+      }
+    }
+  }
+  
+  static inline size_t Hash(const PlanKey &k)
+  {
+    return size_t(PlanHash().Add(k.settings).Add(k.bar).Value());
+  }
+  
+  std::vector<Block> blockring;
+  std::vector<Cut> cutring;
+  std::vector<Phrase> phrases; // a ring, oldest to newest
+  std::vector<long> index; // phrase entries by key, -1 when empty
+  uint64_t cutswritten, blockswritten;
+  uint64_t oldest, newest;
+  Phrase current; // being recorded
+  bool recording;
+};
+
+#endif
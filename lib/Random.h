@@ -0,0 +1,116 @@
+/*
+ This file is part of Livecut
+ Copyright 2026 by the Livecut contributors.
+ 
+ Livecut can be redistributed and/or modified under the terms of the
+ GNU General Public License, as published by the Free Software Foundation;
+ either version 2 of the License, or (at your option) any later version.
+ 
+ Livecut is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Livecut; if not, visit www.gnu.org/licenses or write to the
+ Free Software Foundation, Inc., 59 Temple Place, Suite 330, 
+ Boston, MA 02111-1307 USA
+ */
+
+#ifndef LIVECUT_RANDOM_H
+#define LIVECUT_RANDOM_H
+
+#include <stdint.h>
+
+/**
+ @brief xoshiro128+ pseudo random generator.
+ every instance owns its state, so plug-in instances on different threads
+ neither share nor reseed each other's sequence.
+ */
+class Random
+{
+public:
+  Random(uint32_t seed=1) { Seed(seed); }
+  
+  // the seed is spread over the state with splitmix32, any value is fine
+  void Seed(uint32_t seed)
+  {
+    for(int i=0;i<4;i++)
+    {
+      seed += 0x9e3779b9u;
+      uint32_t z = seed;
+      z = (z ^ (z >> 16)) * 0x85ebca6bu;
+      z = (z ^ (z >> 13)) * 0xc2b2ae35u;
+      s[i] = z ^ (z >> 16);
+    }
+  }
+  
+  inline uint32_t Next()
+  {
+    const uint32_t result = s[0] + s[3];
+    const uint32_t t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 11) | (s[3] >> 21);
+    return result;
+  }
+  
+  // uniform in [0,1], the low bits of xoshiro128+ are weak and dropped
+  inline double Uniform()
+  {
+    return double(Next() >> 8) * (1.0/16777215.0);
+  }
+  
+private:
+  uint32_t s[4];
+};
+
+/**
+ @brief counter-based generator, every draw is a hash of (seed, bar, unit, draw).
+ the cut procedures position it at each block, so the same musical position
+ gives the same numbers however many were drawn before.
+ */
+class CounterRandom
+{
+public:
+  CounterRandom(uint32_t seed=1) : seed(seed), key(0), draw(0) { SetPosition(0,0); }
+  
+  void Seed(uint32_t v) { seed = v; }
+  
+  // draws restart from 0 at every position
+  void SetPosition(long bar, long unit)
+  {
+    key = Mix((uint64_t(seed) << 32) ^ uint32_t(bar));
+    key = Mix(key ^ uint32_t(unit));
+    draw = 0;
+  }
+  
+  inline uint32_t Next()
+  {
+    return uint32_t(Mix(key + (++draw)*0x9e3779b97f4a7c15ull) >> 32);
+  }
+  
+  // same resolution as Random::Uniform
+  inline double Uniform()
+  {
+    return double(Next() >> 8) * (1.0/16777215.0);
+  }
+  
+  // the splitmix64 finalizer, public for hashing
+  static inline uint64_t Mix(uint64_t z)
+  {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+  
+private:
+  uint32_t seed;
+  uint64_t key;
+  uint64_t draw;
+};
+
+#endif
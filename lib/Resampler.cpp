@@ -0,0 +1,127 @@
+/*
+ This file is part of Livecut
+ Copyright 2026 by the Livecut contributors.
+ 
+ Livecut can be redistributed and/or modified under the terms of the
+ GNU General Public License, as published by the Free Software Foundation;
+ either version 2 of the License, or (at your option) any later version.
+ 
+ Livecut is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Livecut; if not, visit www.gnu.org/licenses or write to the
+ Free Software Foundation, Inc., 59 Temple Place, Suite 330, 
+ Boston, MA 02111-1307 USA
+ */
+
+
+#include "Resampler.h"
+#include <cmath>
+
+static const double rspi = 3.14159265358979323846;
+
+static const long qualitytaps[kNumResamplerQualities] = { 2, 8, 32 };
+static const double rolloff[kNumResamplerQualities]   = { 1.0, 0.85, 0.94 };
+static const double beta[kNumResamplerQualities]      = { 0.0, 6.0, 9.0 };
+
+// zeroth order modified bessel function of the first kind
+static double bessel0(double x)
+{
+  double sum = 1.0, term = 1.0;
+  for(int k=1;k<32;++k)
+  {
+    term *= (0.5*x/k)*(0.5*x/k);
+    sum += term;
+    if(term<sum*1e-12)
+      break;
+  }
+  return sum;
+}
+
+// band b covers read speeds up to 2^(b/2), enough for +-2400 cents
+static double bandratio(long b)
+{
+  return pow(2.0,0.5*double(b));
+}
+
+Resampler::Resampler()
+: band(0)
+, quality(kNormal)
+, taps(8)
+, bandindex(0)
+{
+  for(long i=0;i<kMaxTaps;++i)
+    scratch[i] = 0.f;
+}
+
+void Resampler::Prepare()
+{
+  // the tables only depend on the quality, build them once
+  if(!tables[kNormal].empty())
+    return;
+  
+  for(long q=kNormal;q<kNumResamplerQualities;++q)
+  {
+    const long n = qualitytaps[q];
+    const long half = n/2;
+    std::vector<float> &table = tables[q];
+    table.resize(kBands*(kPhases+1)*n);
+    for(long b=0;b<kBands;++b)
+    {
+      const double cutoff = rolloff[q]/bandratio(b);
+      for(long phase=0;phase<=kPhases;++phase)
+      {
+        const double frac = double(phase)/double(kPhases);
+        float *row = &table[(b*(kPhases+1)+phase)*n];
+        double sum = 0.0;
+        for(long k=0;k<n;++k)
+        {
+          const double t = double(k-half+1)-frac; // distance to the read position
+          const double x = cutoff*t;
+          const double sinc = (fabs(x)<1e-9)? 1.0 : sin(rspi*x)/(rspi*x);
+          const double w = t/double(half);
+          const double window = (fabs(w)<1.0)? bessel0(beta[q]*sqrt(1.0-w*w))/bessel0(beta[q]) : 0.0;
+          row[k] = float(cutoff*sinc*window);
+          sum += row[k];
+        }
+        //unity gain at dc
+        for(long k=0;k<n;++k)
+          row[k] = float(row[k]/sum);
+      }
+    }
+  }
+  Select();
+}
+
+void Resampler::SetQuality(long v)
+{
+  if(v<0 || v>=kNumResamplerQualities)
+    v = kNormal;
+  quality = v;
+  Select();
+}
+
+void Resampler::SetRatio(double ratio)
+{
+  long b = 0;
+  while(b<kBands-1 && ratio>bandratio(b)+1e-9)
+    b++;
+  bandindex = b;
+  Select();
+}
+
+void Resampler::Select()
+{
+  taps = qualitytaps[quality];
+  band = tables[quality].empty()? 0 : &tables[quality][bandindex*(kPhases+1)*taps];
+}
+
+void Resampler::Blend(const float *row, float t)
+{
+  const float *next = row+taps;
+  for(long k=0;k<taps;++k)
+    scratch[k] = row[k] + t*(next[k]-row[k]);
+}
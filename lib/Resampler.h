@@ -0,0 +1,108 @@
+/*
+ This file is part of Livecut
+ Copyright 2026 by the Livecut contributors.
+ 
+ Livecut can be redistributed and/or modified under the terms of the
+ GNU General Public License, as published by the Free Software Foundation;
+ either version 2 of the License, or (at your option) any later version.
+ 
+ Livecut is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Livecut; if not, visit www.gnu.org/licenses or write to the
+ Free Software Foundation, Inc., 59 Temple Place, Suite 330, 
+ Boston, MA 02111-1307 USA
+ */
+
+
+#ifndef LIVECUT_RESAMPLER_H
+#define LIVECUT_RESAMPLER_H
+
+#include <vector>
+
+enum ResamplerQuality
+{
+  kDraft=0, // linear interpolation
+  kNormal,  // 8 taps windowed sinc
+  kHigh,    // 32 taps windowed sinc, interpolated between phases
+  kNumResamplerQualities
+};
+
+/**
+ @brief polyphase windowed sinc interpolator for reading at fractional positions.
+ the coefficient tables are precomputed for a few read speed bands, the cutoff
+ of each band is lowered for reading faster than the recording.
+ the cost per sample only depends on the quality.
+ */
+class Resampler
+{
+public:
+  Resampler();
+  
+  // builds the coefficient tables, not real-time safe
+  void Prepare();
+  
+  void SetQuality(long v);
+  // selects the band for the read speed of the next cut
+  void SetRatio(double ratio);
+  
+  // samples needed on each side of a read position
+  inline long Reach() const { return taps/2; }
+  inline long Taps() const { return taps; }
+  // draft quality is plain linear interpolation, done by the caller
+  inline bool IsLinear() const { return quality==kDraft; }
+  
+  // coefficients for the samples x[pos-Reach()+1] ... x[pos+Reach()],
+  // valid until the next call. not for linear interpolation.
+  inline const float *Coefficients(double frac)
+  {
+    const double p = frac*double(kPhases);
+    const long phase = long(p);
+    if(quality==kHigh)
+    {
+      Blend(band+phase*taps,float(p-double(phase)));
+      return scratch;
+    }
+    return band + long(p+0.5)*taps;
+  }
+  
+  // x points at the first sample used by the coefficients, n is a multiple of 4
+  template<class T>
+  static inline T Dot(const float *c, const T *x, long n)
+  {
+    // 4 partial sums the compiler maps onto sse or neon registers
+    T acc[4] = {0,0,0,0};
+    for(long i=0;i<n;i+=4)
+    {
+      acc[0] += c[i]  *x[i];
+      acc[1] += c[i+1]*x[i+1];
+      acc[2] += c[i+2]*x[i+2];
+      acc[3] += c[i+3]*x[i+3];
+    }
+    return (acc[0]+acc[1]) + (acc[2]+acc[3]);
+  }
+  
+  enum
+  {
+    kPhases = 256,
+    kBands = 5,
+    kMaxTaps = 32
+  };
+  
+private:
+  void Blend(const float *row, float t);
+  void Select();
+  
+  // one table per quality, kBands*(kPhases+1) rows of taps coefficients
+  std::vector<float> tables[kNumResamplerQualities];
+  const float *band;
+  long quality;
+  long taps;
+  long bandindex;
+  alignas(16) float scratch[kMaxTaps];
+};
+
+#endif
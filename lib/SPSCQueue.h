@@ -0,0 +1,97 @@
+/*
+ This file is part of Livecut
+ Copyright 2026 by the Livecut contributors.
+ 
+ Livecut can be redistributed and/or modified under the terms of the
+ GNU General Public License, as published by the Free Software Foundation;
+ either version 2 of the License, or (at your option) any later version.
+ 
+ Livecut is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Livecut; if not, visit www.gnu.org/licenses or write to the
+ Free Software Foundation, Inc., 59 Temple Place, Suite 330, 
+ Boston, MA 02111-1307 USA
+ */
+
+#ifndef LIVECUT_SPSC_QUEUE_H
+#define LIVECUT_SPSC_QUEUE_H
+
+#include <atomic>
+#include <vector>
+
+/**
+ @brief wait-free single producer, single consumer queue of preallocated slots.
+ the producer fills the slot Back() returns in place and publishes it with
+ Push(), the consumer reads Front() in place and releases it with Pop(),
+ so a slot owning buffers can be handed over without allocating.
+ neither side ever blocks, a full or empty queue returns NULL.
+ */
+template<class T>
+class SPSCQueue
+{
+public:
+  SPSCQueue() : mask(0), head(0), tail(0) {}
+  
+  // rounds the capacity up to a power of two and empties the queue.
+  // not real-time safe, neither side may use the queue meanwhile
+  void Resize(long capacity)
+  {
+    long size = 1;
+    while(size < capacity)
+      size <<= 1;
+    slots.resize(size);
+    mask = size-1;
+    Clear();
+  }
+  
+  // not thread safe, for setup only
+  void Clear()
+  {
+    head.store(0,std::memory_order_relaxed);
+    tail.store(0,std::memory_order_relaxed);
+  }
+  
+  // every slot, for preallocating their buffers while the queue is idle
+  std::vector<T> &Slots() { return slots; }
+  
+  // producer side
+  T *Back()
+  {
+    const unsigned long t = tail.load(std::memory_order_relaxed);
+    if(slots.empty() || t-head.load(std::memory_order_acquire) > mask)
+      return NULL;
+    return &slots[t & mask];
+  }
+  
+  void Push()
+  {
+    tail.store(tail.load(std::memory_order_relaxed)+1,std::memory_order_release);
+  }
+  
+  // consumer side
+  T *Front()
+  {
+    const unsigned long h = head.load(std::memory_order_relaxed);
+    if(h == tail.load(std::memory_order_acquire))
+      return NULL;
+    return &slots[h & mask];
+  }
+  
+  void Pop()
+  {
+    head.store(head.load(std::memory_order_relaxed)+1,std::memory_order_release);
+  }
+  
+private:
+  std::vector<T> slots;
+  unsigned long mask;
+  // free running counters, only the producer writes tail and the consumer head
+  std::atomic<unsigned long> head;
+  std::atomic<unsigned long> tail;
+};
+
+#endif
@@ -22,6 +22,7 @@
 SQPAmp::SQPAmp()
 : on(true)
 , amp(1.f)
+, random(NULL)
 {
 }
 
@@ -35,9 +36,14 @@ void SQPAmp::OnSemiQuaver(long semi)
     0.21, 0.03, 0.12, 0.09,
     0.24, 0.21, 0.18, 0.21
   };
-  const float random = Math::randomfloat(0.0,1.0);
+  const float value = Math::randomfloat(*random,0.0,1.0);
   const float proba = amptemplate[semi];
-  amp = (random<proba)? 0.f : 1.f;
+  amp = (value<proba)? 0.f : 1.f;
+}
+
+void SQPAmp::SetRandom(Random *r)
+{
+  random = r;
 }
 
 void SQPAmp::SetOn(bool v)
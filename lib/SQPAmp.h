@@ -29,6 +29,7 @@ public:
   
 	void OnSemiQuaver(long semi);
 	void SetOn(bool v);
+	void SetRandom(Random *r);
   
 	inline void tick(float &out1,
                    float &out2, 
@@ -50,6 +51,7 @@ public:
 private:
 	bool on;
 	float amp;
+	Random *random;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,419 @@
+/*
+ This file is part of Livecut
+ Copyright 2026 by the Livecut contributors.
+
+ Livecut can be redistributed and/or modified under the terms of the
+ GNU General Public License, as published by the Free Software Foundation;
+ either version 2 of the License, or (at your option) any later version.
+
+ Livecut is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Livecut; if not, visit www.gnu.org/licenses or write to the
+ Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ Boston, MA 02111-1307 USA
+ */
+
+/*
+ cuttests - checks of the cutter and the player against what they have to play.
+
+ the input is a ramp, each sample holding its own index plus one, so the
+ output tells where every sample was read from. prints every failed check,
+ the exit status is the number of failed tests.
+ */
+
+#include "../lib/BBCutter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+  // 120 bpm in 4/4 at 48 kHz, 8 units of 12000 samples to the bar
+  const double kRate = 48000.0;
+  const double kTempo = 120.0;
+  const long kSubdiv = 8;
+  const long kUnit = 12000;
+
+  // a mono cutter, the channel its own partner, so cuts play at their amplitude
+  struct Rig
+  {
+    LivePlayer<float> player;
+    BBCutter cutter;
+
+    Rig() : cutter(player)
+    {
+      player.SetChannelPairs(std::vector<long>(1,0));
+      cutter.SetTimeInfos(kTempo,4,4,kRate);
+      cutter.SetSubdiv(kSubdiv);
+      cutter.Prepare(kRate,30.0,4.0,32);
+      cutter.SetFade(0.f);
+    }
+
+    bool Load(const std::string &text)
+    {
+      std::unique_ptr<CutPattern> pattern(new CutPattern);
+      std::string error;
+      if(!CompileCutPattern(text,*pattern,error))
+      {
+        std::printf("pattern does not compile: %s\n",error.c_str());
+        return false;
+      }
+      cutter.SetCutPattern(std::move(pattern));
+      cutter.SetUsePattern(true);
+      return true;
+    }
+
+    // plays the units from first on, out holds the whole input length
+    void Play(const std::vector<float> &in, std::vector<float> &out, long first, long units)
+    {
+      for(long u=first;u<first+units;u++)
+      {
+        cutter.SetPosition(u/kSubdiv,u%kSubdiv);
+        Render(in,out,u*kUnit,kUnit);
+      }
+    }
+
+    // jumps to a unit and phase with the input before it in the history, then plays on
+    void Seek(const std::vector<float> &in, std::vector<float> &out, long unit, double phase)
+    {
+      const float *src = in.data();
+      const long skipped = long(phase*kUnit);
+      for(long done=0;done<unit*kUnit+skipped;)
+        done += player.Skip(&src,done,unit*kUnit+skipped-done);
+      cutter.Seek(unit/kSubdiv,unit%kSubdiv,phase);
+      Render(in,out,unit*kUnit+skipped,kUnit-skipped);
+      Play(in,out,unit+1,long(in.size())/kUnit-unit-1);
+    }
+
+    void Render(const std::vector<float> &in, std::vector<float> &out, long offset, long n)
+    {
+      const float *src = in.data();
+      float *dst = out.data();
+      for(long done=0;done<n;)
+        done += player.process(&src,&dst,offset+done,n-done);
+    }
+  };
+
+  std::vector<float> Ramp(long n)
+  {
+    std::vector<float> ramp(n);
+    for(long i=0;i<n;i++)
+      ramp[i] = float(i+1);
+    return ramp;
+  }
+
+  // the share of samples from first on that were read from delay samples before them
+  double ReadFrom(const std::vector<float> &out, long first, long delay)
+  {
+    long hits = 0;
+    for(long i=first;i<long(out.size());i++)
+      if(out[i] == float(i-delay+1))
+        hits++;
+    return double(hits)/double(out.size()-first);
+  }
+
+  // blocks of a lookback read the input from that many units before them
+  bool TestLookback()
+  {
+    const long units = 8*kSubdiv;
+    const std::vector<float> in = Ramp(units*kUnit);
+    bool ok = true;
+
+    Rig straight;
+    std::vector<float> out(in.size());
+    if(!straight.Load("block 4\nrepeat 1\n"))
+      return false;
+    straight.Play(in,out,0,units);
+    if(ReadFrom(out,0,0) < 0.99)
+    {
+      std::printf("lookback: blocks without a lookback do not play the input as it comes\n");
+      ok = false;
+    }
+
+    Rig late;
+    if(!late.Load("block 4\nrepeat 1\nlookback 1 2\n"))
+      return false;
+    late.Play(in,out,0,units);
+    // the first two units have nothing that far back yet
+    if(ReadFrom(out,2*kUnit,2*kUnit) < 0.99)
+    {
+      std::printf("lookback: blocks do not read from two units before them\n");
+      ok = false;
+    }
+    return ok;
+  }
+
+  // blocks longer than the player holds play what it holds, a lookback included,
+  // then silence to their end
+  bool TestLongLookback()
+  {
+    const long units = 16*kSubdiv;
+    const std::vector<float> in = Ramp(units*kUnit);
+    // a bar at the slowest tempo the rig is prepared for
+    const long held = 4*kSubdiv*kUnit;
+    const long block = 64*kUnit;
+
+    Rig rig;
+    std::vector<float> out(in.size());
+    if(!rig.Load("phrase 16\nblock 64\nrepeat 1\nlookback 1 4\n"))
+      return false;
+    rig.Play(in,out,0,units);
+
+    // past the fades at either end of the cut
+    long wrong = 0;
+    for(long i=block+16;i<2*block;i++)
+      if(i<block+held-16? out[i] != float(i-4*kUnit+1) : i>=block+held && out[i] != 0.f)
+        wrong++;
+    if(wrong > 0)
+    {
+      std::printf("long lookback: %ld samples of a block longer than the player holds "
+                  "are not what it holds or silence\n",wrong);
+      return false;
+    }
+    return true;
+  }
+
+  // one block as planned, where it falls in its phrase included
+  struct Block
+  {
+    long bar, unit, units;
+    std::vector<CutInfo> cuts;
+
+    bool operator==(const Block &b) const
+    {
+      if(bar != b.bar || unit != b.unit || units != b.units || cuts.size() != b.cuts.size())
+        return false;
+      for(size_t i=0;i<cuts.size();i++)
+        if(cuts[i].size != b.cuts[i].size || cuts[i].length != b.cuts[i].length ||
+           cuts[i].offset != b.cuts[i].offset || cuts[i].pan != b.cuts[i].pan ||
+           cuts[i].amp != b.cuts[i].amp || cuts[i].cents != b.cuts[i].cents)
+          return false;
+      return true;
+    }
+  };
+
+  // the blocks planned from a restart on bar until the one of the last bar
+  std::vector<Block> PlanFrom(CutPlanner &planner, long bar, long lastbar)
+  {
+    std::vector<Block> blocks;
+    planner.Restart(bar);
+    long unit = 0, phrasebar = 0;
+    for(BlockPlan *plan = planner.Front();plan;plan = planner.Front())
+    {
+      if(plan->phrase)
+      {
+        phrasebar = plan->bar;
+        unit = 0;
+      }
+      if(phrasebar*kSubdiv+unit >= lastbar*kSubdiv)
+        break;
+      Block block = { phrasebar, unit, plan->units,
+                      std::vector<CutInfo>(plan->cuts.begin(),plan->cuts.end()) };
+      blocks.push_back(block);
+      unit += std::max(plan->units,1L);
+      planner.Pop();
+    }
+    return blocks;
+  }
+
+  // the phrase a bar falls into only depends on the bar, so does every block of it
+  bool TestPhraseStarts()
+  {
+    const char *names[] = { "cutproc11", "warpcut", "sqpusher" };
+    const long starts[] = { 1, 2, 3, 5, 6, 11, 17 };
+    const long lastbar = 40;
+    bool ok = true;
+    for(long strategy=kCutProc11;strategy<kPattern;strategy++)
+    {
+      CutSettings settings;
+      settings.strategy = strategy;
+      settings.subdiv = settings.unitsperbar = kSubdiv;
+      settings.spu = double(kUnit);
+      settings.minphraselength = 1;
+      settings.maxphraselength = 4;
+      settings.seed = 7;
+      CutPlanner planner;
+      planner.Prepare(256);
+      planner.Publish(settings);
+
+      const std::vector<Block> through = PlanFrom(planner,0,lastbar);
+      for(long start : starts)
+      {
+        const std::vector<Block> restarted = PlanFrom(planner,start,lastbar);
+        // from the start of the phrase the bar falls into on, as if played through
+        size_t first = 0;
+        while(first < through.size() && !(through[first].bar == restarted[0].bar &&
+                                          through[first].unit == 0))
+          first++;
+        const bool same = restarted[0].bar <= start &&
+                          restarted.size() == through.size()-first &&
+                          std::equal(restarted.begin(),restarted.end(),through.begin()+first);
+        if(!same)
+        {
+          std::printf("phrase starts: %s plans other blocks from bar %ld than played through\n",
+                      names[strategy],start);
+          ok = false;
+        }
+      }
+    }
+    return ok;
+  }
+
+  // a phrase replayed from the cache is the one planned without it
+  bool TestReplay()
+  {
+    const char *names[] = { "cutproc11", "warpcut", "sqpusher" };
+    const long lastbar = 40;
+    bool ok = true;
+    for(long strategy=kCutProc11;strategy<kPattern;strategy++)
+    {
+      CutSettings settings;
+      settings.strategy = strategy;
+      settings.subdiv = settings.unitsperbar = kSubdiv;
+      settings.spu = double(kUnit);
+      settings.seed = 5;
+      CutPlanner fresh, cached;
+      fresh.Prepare(256);
+      cached.Prepare(256);
+      cached.SetCacheBudget(1<<20);
+      fresh.Publish(settings);
+      cached.Publish(settings);
+
+      const std::vector<Block> planned = PlanFrom(fresh,0,lastbar);
+      PlanFrom(cached,0,lastbar);
+      for(int pass=0;pass<2;pass++)
+      {
+        if(PlanFrom(cached,0,lastbar) != planned)
+        {
+          std::printf("replay: %s replays other blocks than it plans\n",names[strategy]);
+          ok = false;
+        }
+      }
+    }
+    return ok;
+  }
+
+  // the cache keeps the phrases found last, not the ones recorded last
+  bool TestCacheRecency()
+  {
+    typedef PlanCache<CutInfo> Cache;
+    // 16 blocks of up to 4 cuts, four phrases of 4 blocks of 4 cuts
+    Cache cache;
+    cache.SetBudget(16*(sizeof(Cache::Block)+4*sizeof(CutInfo)));
+    auto Record = [&cache](long bar) {
+      const PlanKey key = { 1, bar };
+      cache.Begin(key,16);
+      for(long b=0;b<4;b++)
+      {
+        CutInfo cuts[4];
+        for(long i=0;i<4;i++)
+          cuts[i].size = bar*100+b*10+i;
+        cache.Append(4,cuts,4);
+      }
+      cache.End();
+    };
+    auto Holds = [&cache](long bar) {
+      const PlanKey key = { 1, bar };
+      const Cache::Phrase *phrase = cache.Find(key);
+      if(!phrase || phrase->blocks != 4)
+        return false;
+      for(long b=0;b<4;b++)
+      {
+        CutInfo cuts[4];
+        cache.CopyCuts(cache.BlockOf(*phrase,b),cuts);
+        for(long i=0;i<4;i++)
+          if(cuts[i].size != bar*100+b*10+i)
+            return false;
+      }
+      return true;
+    };
+
+    for(long bar=0;bar<4;bar++)
+      Record(bar);
+    // found again, bar 0 is newer than bar 1 now
+    const bool found = Holds(0);
+    Record(4);
+    const PlanKey evicted = { 1, 1 };
+    if(!found || cache.Find(evicted) || !Holds(0) || !Holds(4))
+    {
+      std::printf("cache recency: the phrase found last is not kept over the one recorded first\n");
+      return false;
+    }
+    return true;
+  }
+
+  // a seek plays what playing through would have played from there on, however
+  // far into the phrase and the unit it lands, whether planned in the background or not
+  bool TestSeek()
+  {
+    const long units = 12*kSubdiv;
+    const std::vector<float> in = Ramp(units*kUnit);
+    const long seeks[][2] = { { 3*kSubdiv+5, 500 }, { 6*kSubdiv, 0 }, { 9*kSubdiv+2, 250 } };
+    bool ok = true;
+
+    Rig through;
+    std::vector<float> expected(in.size());
+    through.Play(in,expected,0,units);
+
+    // where the phrase of the seek ends, the seeker plans no further
+    CutSettings settings;
+    settings.spu = double(kUnit);
+    CutPlanner planner;
+    planner.Prepare(256);
+    planner.Publish(settings);
+
+    for(int background=0;background<2;background++)
+    {
+      for(const long *seek : seeks)
+      {
+        const long unit = seek[0];
+        const double phase = double(seek[1])/1000.0;
+        Rig rig;
+        rig.cutter.SetBackgroundPlanning(background != 0);
+        std::vector<float> out(in.size());
+        rig.Seek(in,out,unit,phase);
+        rig.cutter.SetBackgroundPlanning(false);
+
+        long end = long(out.size());
+        if(background)
+        {
+          planner.Restart(unit/kSubdiv);
+          const BlockPlan *plan = planner.Front();
+          end = (plan->bar+(plan->totalunits+kSubdiv-1)/kSubdiv)*kSubdiv*kUnit;
+        }
+        // the cut resumed fades in
+        const long first = unit*kUnit+long(phase*kUnit)+16;
+        long wrong = 0;
+        for(long i=first;i<end;i++)
+          if(out[i] != expected[i])
+            wrong++;
+        if(wrong > 0)
+        {
+          std::printf("seek: %ld of %ld samples differ from playing through after a seek "
+                      "to unit %ld%s\n",wrong,end-first,unit,background? " in the background" : "");
+          ok = false;
+        }
+      }
+    }
+    return ok;
+  }
+}
+
+int main()
+{
+  int failed = 0;
+  failed += !TestLookback();
+  failed += !TestLongLookback();
+  failed += !TestPhraseStarts();
+  failed += !TestSeek();
+  failed += !TestReplay();
+  failed += !TestCacheRecency();
+  std::printf("%s\n",failed? "FAILED" : "passed");
+  return failed;
+}
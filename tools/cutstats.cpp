@@ -0,0 +1,445 @@
+/*
+ This file is part of Livecut
+ Copyright 2026 by the Livecut contributors.
+ 
+ Livecut can be redistributed and/or modified under the terms of the
+ GNU General Public License, as published by the Free Software Foundation;
+ either version 2 of the License, or (at your option) any later version.
+ 
+ Livecut is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with Livecut; if not, visit www.gnu.org/licenses or write to the
+ Free Software Foundation, Inc., 59 Temple Place, Suite 330, 
+ Boston, MA 02111-1307 USA
+ */
+
+/*
+ cutstats - what the cut procedures produce across their parameter space.
+ 
+ every thread plans phrases with its own planner and generator, each phrase
+ with settings drawn at random from the ranges of the plug-in parameters.
+ reports the cuts per block, the cut sizes and the worst cases, the settings
+ that caused them included, as CSV or JSON.
+ 
+ usage: cutstats [options]
+   --phrases n       phrases per procedure, 1000000 by default
+   --threads n       worker threads, all cores by default
+   --proc name       cutproc11, warpcut, sqpusher, pattern or all (default)
+   --pattern file    cut pattern for the pattern procedure
+   --tempo bpm       120 by default
+   --samplerate hz   44100 by default
+   --seed n          first generator seed, 1 by default
+   --format f        csv (default) or json
+ */
+
+#include "../lib/BBCutter.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const long subdivs[] = {6, 8, 12, 16, 18, 24, 32};
+const long maxsubdiv = 32;
+
+// the cut lists the plug-in prepares, see BBCutter::Prepare
+const long plugincuts = std::max(8*maxsubdiv,32L);
+// room to see how far a block would go past them
+const long maxcuts = 16*plugincuts;
+
+// cut sizes by powers of two samples
+enum { kSizeBuckets = 24 };
+
+const char *procnames[] = {"cutproc11", "warpcut", "sqpusher", "pattern"};
+
+struct Options
+{
+  long phrases;
+  long threads;
+  long proc; // kAll for every one
+  std::string pattern;
+  double tempo;
+  double samplerate;
+  unsigned long seed;
+  bool json;
+};
+
+struct Stats
+{
+  long phrases, blocks, cuts;
+  long clipped; // blocks with more cuts than the plug-in holds
+  std::vector<long> cutsperblock; // the last bucket counts the rest
+  std::vector<long> cutsizes;
+  
+  long mincutsize;
+  CutSettings mincutsettings;
+  long maxcutsperbar;
+  CutSettings maxbarsettings;
+  long maxcutsperblock;
+  CutSettings maxblocksettings;
+  
+  Stats()
+  : phrases(0), blocks(0), cuts(0), clipped(0)
+  , cutsperblock(plugincuts+2,0), cutsizes(kSizeBuckets,0)
+  , mincutsize(-1), maxcutsperbar(0), maxcutsperblock(0)
+  {}
+  
+  void Merge(const Stats &s)
+  {
+    phrases += s.phrases;
+    blocks += s.blocks;
+    cuts += s.cuts;
+    clipped += s.clipped;
+    for(size_t i=0;i<cutsperblock.size();i++)
+      cutsperblock[i] += s.cutsperblock[i];
+    for(size_t i=0;i<cutsizes.size();i++)
+      cutsizes[i] += s.cutsizes[i];
+    if(s.mincutsize >= 0 && (mincutsize < 0 || s.mincutsize < mincutsize))
+    {
+      mincutsize = s.mincutsize;
+      mincutsettings = s.mincutsettings;
+    }
+    if(s.maxcutsperbar > maxcutsperbar)
+    {
+      maxcutsperbar = s.maxcutsperbar;
+      maxbarsettings = s.maxbarsettings;
+    }
+    if(s.maxcutsperblock > maxcutsperblock)
+    {
+      maxcutsperblock = s.maxcutsperblock;
+      maxblocksettings = s.maxblocksettings;
+    }
+  }
+};
+
+// a point of the parameter space, drawn from the plug-in parameter ranges
+template<class G>
+CutSettings DrawSettings(G &g, long proc, const Options &options)
+{
+  std::uniform_real_distribution<float> unit(0.f,1.f);
+  std::uniform_int_distribution<long> subdiv(0,long(sizeof(subdivs)/sizeof(subdivs[0]))-1);
+  std::uniform_int_distribution<long> phrase(1,8);
+  std::uniform_int_distribution<long> repeats(0,4);
+  std::uniform_int_distribution<long> seed(1,16);
+  
+  CutSettings s;
+  s.strategy = proc;
+  s.subdiv = subdivs[subdiv(g)];
+  s.unitsperbar = s.subdiv; // 4/4
+  s.spu = options.samplerate*60.0/options.tempo*4.0/double(s.subdiv);
+  s.seed = uint32_t(seed(g));
+  s.minamp = unit(g);
+  s.maxamp = unit(g);
+  s.minpan = unit(g)*2.f-1.f;
+  s.maxpan = unit(g)*2.f-1.f;
+  s.mindetune = (unit(g)-0.5f)*4800.f;
+  s.maxdetune = (unit(g)-0.5f)*4800.f;
+  s.dutycycle = unit(g);
+  s.filldutycycle = unit(g);
+  s.minphraselength = phrase(g);
+  s.maxphraselength = phrase(g);
+  if(s.minphraselength > s.maxphraselength)
+    std::swap(s.minphraselength,s.maxphraselength);
+  s.minrepeats = repeats(g);
+  s.maxrepeats = repeats(g);
+  if(s.minrepeats > s.maxrepeats)
+    std::swap(s.minrepeats,s.maxrepeats);
+  s.stutterchance = unit(g);
+  s.stutterarea = unit(g);
+  s.straightchance = unit(g);
+  s.regularchance = unit(g);
+  s.ritardchance = unit(g);
+  s.accel = 0.5f+unit(g)*0.499f;
+  s.activity = unit(g);
+  return s;
+}
+
+// plans phrases phrase by phrase, every one with new settings
+void Run(long proc, long phrases, unsigned long seed, const CutPattern *pattern,
+         const Options &options, Stats &stats)
+{
+  std::mt19937_64 g(seed);
+  CutPlanner planner;
+  planner.Prepare(maxcuts);
+  if(pattern)
+    planner.SetPattern(std::unique_ptr<CutPattern>(new CutPattern(*pattern)));
+  
+  long bar = 0;
+  for(long n=0;n<phrases;n++)
+  {
+    const CutSettings settings = DrawSettings(g,proc,options);
+    planner.Publish(settings);
+    planner.Restart(bar);
+    
+    // the planner runs on demand, every plan is a block
+    long unitsdone = 0, currentbar = -1, cutsinbar = 0;
+    BlockPlan *plan = planner.Front();
+    const long totalunits = plan->totalunits;
+    // the phrase the bar falls into, it may start before it
+    const long phrasebar = plan->bar;
+    while(plan && unitsdone < totalunits)
+    {
+      const long cuts = plan->cuts.size();
+      stats.blocks++;
+      stats.cuts += cuts;
+      stats.cutsperblock[std::min(cuts,long(stats.cutsperblock.size())-1)]++;
+      if(cuts > plugincuts)
+        stats.clipped++;
+      if(cuts > stats.maxcutsperblock)
+      {
+        stats.maxcutsperblock = cuts;
+        stats.maxblocksettings = settings;
+      }
+      for(long i=0;i<cuts;i++)
+      {
+        const long size = plan->cuts[i].size;
+        long bucket = 0;
+        while(bucket < kSizeBuckets-1 && (1L << (bucket+1)) <= size)
+          bucket++;
+        stats.cutsizes[bucket]++;
+        if(stats.mincutsize < 0 || size < stats.mincutsize)
+        {
+          stats.mincutsize = size;
+          stats.mincutsettings = settings;
+        }
+      }
+      
+      // a block counts to the bar it starts in
+      const long blockbar = unitsdone/std::max(settings.unitsperbar,1L);
+      if(blockbar != currentbar)
+      {
+        currentbar = blockbar;
+        cutsinbar = 0;
+      }
+      cutsinbar += cuts;
+      if(cutsinbar > stats.maxcutsperbar)
+      {
+        stats.maxcutsperbar = cutsinbar;
+        stats.maxbarsettings = settings;
+      }
+      
+      unitsdone += std::max(plan->units,1L);
+      planner.Pop();
+      plan = planner.Front();
+    }
+    stats.phrases++;
+    bar = phrasebar+std::max((totalunits+settings.unitsperbar-1)/settings.unitsperbar,1L);
+  }
+}
+
+bool ParseOptions(int argc, char **argv, Options &options)
+{
+  options.phrases = 1000000;
+  options.threads = std::max(long(std::thread::hardware_concurrency()),1L);
+  options.proc = kAll;
+  options.tempo = 120.0;
+  options.samplerate = 44100.0;
+  options.seed = 1;
+  options.json = false;
+  
+  for(int i=1;i<argc;i++)
+  {
+    const std::string arg = argv[i];
+    if(i+1 >= argc)
+      return false;
+    const char *value = argv[++i];
+    if(arg == "--phrases")
+      options.phrases = std::max(atol(value),1L);
+    else if(arg == "--threads")
+      options.threads = std::max(atol(value),1L);
+    else if(arg == "--tempo")
+      options.tempo = std::max(atof(value),1.0);
+    else if(arg == "--samplerate")
+      options.samplerate = std::max(atof(value),1.0);
+    else if(arg == "--seed")
+      options.seed = strtoul(value,NULL,10);
+    else if(arg == "--pattern")
+      options.pattern = value;
+    else if(arg == "--format" && (!strcmp(value,"csv") || !strcmp(value,"json")))
+      options.json = !strcmp(value,"json");
+    else if(arg == "--proc")
+    {
+      options.proc = -1;
+      for(long p=0;p<kAll;p++)
+        if(!strcmp(value,procnames[p]))
+          options.proc = p;
+      if(!strcmp(value,"all"))
+        options.proc = kAll;
+      if(options.proc < 0)
+        return false;
+    }
+    else
+      return false;
+  }
+  return true;
+}
+
+// the fields the procedures read, named as the parameters
+std::vector<std::pair<const char*,double> > Fields(const CutSettings &s)
+{
+  std::vector<std::pair<const char*,double> > f;
+  f.push_back(std::make_pair("subdiv",double(s.subdiv)));
+  f.push_back(std::make_pair("seed",double(s.seed)));
+  f.push_back(std::make_pair("minamp",s.minamp));
+  f.push_back(std::make_pair("maxamp",s.maxamp));
+  f.push_back(std::make_pair("minpan",s.minpan));
+  f.push_back(std::make_pair("maxpan",s.maxpan));
+  f.push_back(std::make_pair("mindetune",s.mindetune));
+  f.push_back(std::make_pair("maxdetune",s.maxdetune));
+  f.push_back(std::make_pair("duty",s.dutycycle));
+  f.push_back(std::make_pair("fillduty",s.filldutycycle));
+  f.push_back(std::make_pair("minphrase",double(s.minphraselength)));
+  f.push_back(std::make_pair("maxphrase",double(s.maxphraselength)));
+  f.push_back(std::make_pair("minrepeats",double(s.minrepeats)));
+  f.push_back(std::make_pair("maxrepeats",double(s.maxrepeats)));
+  f.push_back(std::make_pair("stutter",s.stutterchance));
+  f.push_back(std::make_pair("area",s.stutterarea));
+  f.push_back(std::make_pair("straight",s.straightchance));
+  f.push_back(std::make_pair("regular",s.regularchance));
+  f.push_back(std::make_pair("ritard",s.ritardchance));
+  f.push_back(std::make_pair("speed",s.accel));
+  f.push_back(std::make_pair("activity",s.activity));
+  return f;
+}
+
+void PrintCSV(long proc, const Stats &s, bool header)
+{
+  if(header)
+    printf("proc,metric,key,value\n");
+  const char *name = procnames[proc];
+  printf("%s,phrases,,%ld\n",name,s.phrases);
+  printf("%s,blocks,,%ld\n",name,s.blocks);
+  printf("%s,cuts,,%ld\n",name,s.cuts);
+  printf("%s,clipped_blocks,,%ld\n",name,s.clipped);
+  for(size_t i=0;i<s.cutsperblock.size();i++)
+    if(s.cutsperblock[i])
+      printf("%s,cuts_per_block,%s%zu,%ld\n",name,
+             i+1 == s.cutsperblock.size()? ">=" : "",i,s.cutsperblock[i]);
+  for(size_t i=0;i<s.cutsizes.size();i++)
+    if(s.cutsizes[i])
+      printf("%s,cut_size_log2,%zu,%ld\n",name,i,s.cutsizes[i]);
+  
+  const struct { const char *metric; long value; const CutSettings *settings; } worst[] = {
+    {"min_cut_size", s.mincutsize, &s.mincutsettings},
+    {"max_cuts_per_block", s.maxcutsperblock, &s.maxblocksettings},
+    {"max_cuts_per_bar", s.maxcutsperbar, &s.maxbarsettings}};
+  for(size_t w=0;w<sizeof(worst)/sizeof(worst[0]);w++)
+  {
+    printf("%s,%s,,%ld\n",name,worst[w].metric,worst[w].value);
+    std::vector<std::pair<const char*,double> > f = Fields(*worst[w].settings);
+    for(size_t i=0;i<f.size();i++)
+      printf("%s,%s,%s,%g\n",name,worst[w].metric,f[i].first,f[i].second);
+  }
+}
+
+void PrintJSON(long proc, const Stats &s, bool first, bool last)
+{
+  if(first)
+    printf("{\n");
+  printf("  \"%s\": {\n",procnames[proc]);
+  printf("    \"phrases\": %ld,\n    \"blocks\": %ld,\n    \"cuts\": %ld,\n",s.phrases,s.blocks,s.cuts);
+  printf("    \"clipped_blocks\": %ld,\n",s.clipped);
+  printf("    \"cuts_per_block\": [");
+  for(size_t i=0;i<s.cutsperblock.size();i++)
+    printf("%s%ld",i? ", " : "",s.cutsperblock[i]);
+  printf("],\n    \"cut_size_log2\": [");
+  for(size_t i=0;i<s.cutsizes.size();i++)
+    printf("%s%ld",i? ", " : "",s.cutsizes[i]);
+  printf("],\n");
+  
+  const struct { const char *metric; long value; const CutSettings *settings; } worst[] = {
+    {"min_cut_size", s.mincutsize, &s.mincutsettings},
+    {"max_cuts_per_block", s.maxcutsperblock, &s.maxblocksettings},
+    {"max_cuts_per_bar", s.maxcutsperbar, &s.maxbarsettings}};
+  const size_t numworst = sizeof(worst)/sizeof(worst[0]);
+  for(size_t w=0;w<numworst;w++)
+  {
+    printf("    \"%s\": {\"value\": %ld, \"settings\": {",worst[w].metric,worst[w].value);
+    std::vector<std::pair<const char*,double> > f = Fields(*worst[w].settings);
+    for(size_t i=0;i<f.size();i++)
+      printf("%s\"%s\": %g",i? ", " : "",f[i].first,f[i].second);
+    printf("}}%s\n",w+1 < numworst? "," : "");
+  }
+  printf("  }%s\n",last? "" : ",");
+  if(last)
+    printf("}\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  Options options;
+  if(!ParseOptions(argc,argv,options))
+  {
+    fprintf(stderr,"usage: cutstats [--phrases n] [--threads n] [--proc cutproc11|warpcut|sqpusher|pattern|all]\n"
+                   "                [--pattern file] [--tempo bpm] [--samplerate hz] [--seed n] [--format csv|json]\n");
+    return 1;
+  }
+  
+  CutPattern pattern;
+  bool haspattern = false;
+  if(!options.pattern.empty())
+  {
+    std::ifstream file(options.pattern.c_str(),std::ios::binary);
+    std::stringstream text;
+    text << file.rdbuf();
+    std::string error;
+    if(!file || !CompileCutPattern(text.str(),pattern,error))
+    {
+      fprintf(stderr,"%s: %s\n",options.pattern.c_str(),file? error.c_str() : "cannot be read");
+      return 1;
+    }
+    haspattern = true;
+  }
+  
+  std::vector<long> procs;
+  for(long p=0;p<kAll;p++)
+  {
+    // without a pattern the pattern procedure falls back to CutProc11
+    if((options.proc == kAll || options.proc == p) && (p != kPattern || haspattern))
+      procs.push_back(p);
+  }
+  if(procs.empty())
+  {
+    fprintf(stderr,"the pattern procedure needs --pattern\n");
+    return 1;
+  }
+  
+  for(size_t p=0;p<procs.size();p++)
+  {
+    // one generator per thread, each thread a share of the phrases
+    std::vector<Stats> stats(options.threads);
+    std::vector<std::thread> threads;
+    for(long t=0;t<options.threads;t++)
+    {
+      const long phrases = options.phrases/options.threads + (t < options.phrases%options.threads);
+      const unsigned long seed = options.seed + (unsigned long)(p*options.threads + t);
+      threads.push_back(std::thread(Run,procs[p],phrases,seed,
+                                    haspattern? &pattern : (const CutPattern*)NULL,
+                                    std::cref(options),std::ref(stats[t])));
+    }
+    for(size_t t=0;t<threads.size();t++)
+      threads[t].join();
+    for(size_t t=1;t<stats.size();t++)
+      stats[0].Merge(stats[t]);
+    
+    if(options.json)
+      PrintJSON(procs[p],stats[0],p == 0,p+1 == procs.size());
+    else
+      PrintCSV(procs[p],stats[0],p == 0);
+  }
+  return 0;
+}
@@ -0,0 +1,200 @@
+/*
+ This file is part of Livecut
+ Copyright 2026 by the Livecut contributors.
+
+ Livecut can be redistributed and/or modified under the terms of the
+ GNU General Public License, as published by the Free Software Foundation;
+ either version 2 of the License, or (at your option) any later version.
+
+ Livecut is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Livecut; if not, visit www.gnu.org/licenses or write to the
+ Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ Boston, MA 02111-1307 USA
+ */
+
+/*
+ kernelbench - the fixed cost of a process call at small block sizes.
+
+ renders the same stretch of audio through the kernel at block sizes 1, 16,
+ 32 and 64, with the parameters handed over the way the processor does:
+   idle       no parameter changes
+   automated  one parameter changes every call
+   state      every parameter is offered every call, only the changed ones
+              reach the kernel, as after a state transfer
+   unfiltered every parameter reaches the kernel every call, the cost the
+              changed parameter mask avoids
+ reports the best of several runs per case as CSV, in nanoseconds per call
+ and per sample.
+
+ usage: kernelbench [options]
+   --seconds n       audio rendered per run, 10 by default
+   --runs n          runs per case, 5 by default
+   --tempo bpm       120 by default
+   --samplerate hz   44100 by default
+ */
+
+#include "../VST3/source/dspkernel.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using namespace Livecut;
+
+const long blocksizes[] = {1, 16, 32, 64};
+
+enum Scenario
+{
+  kIdle=0,
+  kAutomated,
+  kState,
+  kUnfiltered,
+  kNumScenarios
+};
+
+const char *scenarionames[] = {"idle", "automated", "state", "unfiltered"};
+
+const ParamID numparameters = paramID(ParameterID::ParameterCount);
+
+struct Options
+{
+  double seconds;
+  long runs;
+  double tempo;
+  double samplerate;
+};
+
+bool ParseOptions(int argc, char **argv, Options &options)
+{
+  options.seconds = 10.0;
+  options.runs = 5;
+  options.tempo = 120.0;
+  options.samplerate = 44100.0;
+
+  for(int i=1;i<argc;i++)
+  {
+    const std::string arg = argv[i];
+    if(i+1 >= argc)
+      return false;
+    const char *value = argv[++i];
+    if(arg == "--seconds")
+      options.seconds = std::max(atof(value),0.1);
+    else if(arg == "--runs")
+      options.runs = std::max(atol(value),1L);
+    else if(arg == "--tempo")
+      options.tempo = std::max(atof(value),1.0);
+    else if(arg == "--samplerate")
+      options.samplerate = std::max(atof(value),1.0);
+    else
+      return false;
+  }
+  return true;
+}
+
+// nanoseconds per call for one run
+double Run(const Options &options, long blocksize, Scenario scenario, const std::vector<float> &input)
+{
+  std::unique_ptr<Kernel<float> > kernel(new Kernel<float>);
+  kernel->setChannelLayout({1, 0});
+  kernel->setSampleRate(options.samplerate);
+  // the normalized values and the changed parameter mask of the processor
+  KernelParameters parameters;
+  parameters.changeAll();
+  parameters.flush(*kernel);
+
+  const long length = long(input.size());
+  std::vector<float> left(length), right(length);
+  Kernel<float>::TimeInfo timeinfo;
+  timeinfo.tempo = options.tempo;
+  timeinfo.playing = true;
+
+  const ParamID automated = paramID(ParameterID::CombFeedback);
+  long calls = 0;
+  auto start = std::chrono::steady_clock::now();
+  for(long pos=0;pos+blocksize<=length;pos+=blocksize,calls++)
+  {
+    // a slow sweep, a new value every call
+    const double value = 0.5 + 0.4*std::sin(calls*1e-3);
+    switch(scenario)
+    {
+      case kIdle:
+        break;
+      case kAutomated:
+        parameters.change(automated,value);
+        parameters.flush(*kernel);
+        break;
+      case kState:
+        for(ParamID pid=0;pid<numparameters;pid++)
+          parameters.change(pid,pid == automated? value : parameters[pid]);
+        parameters.flush(*kernel);
+        break;
+      case kUnfiltered:
+        parameters[automated] = value;
+        parameters.changeAll();
+        parameters.flush(*kernel);
+        break;
+      case kNumScenarios:
+        break;
+    }
+
+    std::copy(&input[pos],&input[pos]+blocksize,&left[pos]);
+    std::copy(&input[pos],&input[pos]+blocksize,&right[pos]);
+    float *io[2] = {&left[pos], &right[pos]};
+    timeinfo.ppqPos = pos/options.samplerate*options.tempo/60.0;
+    kernel->process(io,io,0,uint32_t(blocksize),timeinfo);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double,std::nano>(end-start).count()/std::max(calls,1L);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  Options options;
+  if(!ParseOptions(argc,argv,options))
+  {
+    fprintf(stderr,"usage: kernelbench [--seconds n] [--runs n] [--tempo bpm] [--samplerate hz]\n");
+    return 1;
+  }
+
+  // a decaying noise burst every beat, something for the cuts to chop
+  std::vector<float> input(long(options.seconds*options.samplerate));
+  const long beat = long(60.0/options.tempo*options.samplerate);
+  uint32_t noise = 1;
+  for(size_t i=0;i<input.size();i++)
+  {
+    noise = noise*1664525u + 1013904223u;
+    const float white = float(noise>>8)/float(1<<24)*2.f-1.f;
+    input[i] = white*std::exp(-float(i%beat)/(0.1f*beat));
+  }
+
+  printf("blocksize,scenario,ns_per_call,ns_per_sample\n");
+  for(long blocksize : blocksizes)
+  {
+    for(long s=0;s<kNumScenarios;s++)
+    {
+      double best = 0.0;
+      for(long r=0;r<options.runs;r++)
+      {
+        const double ns = Run(options,blocksize,Scenario(s),input);
+        if(r == 0 || ns < best)
+          best = ns;
+      }
+      printf("%ld,%s,%.1f,%.2f\n",blocksize,scenarionames[s],best,best/blocksize);
+    }
+  }
+  return 0;
+}